@@ -0,0 +1,165 @@
+#include "ColorExport.h"
+
+#include <cstring>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+const unsigned int ColorExport::MAGIC;
+const unsigned int ColorExport::VERSION;
+const unsigned int ColorExport::HEADER_BYTES;
+const unsigned int ColorExport::SLOT_HEADER_BYTES;
+
+// header fields, in order
+enum {
+    FIELD_MAGIC,
+    FIELD_VERSION,
+    FIELD_VALUE_COUNT,
+    FIELD_SLOT_COUNT,
+    FIELD_SLOT_STRIDE,
+    FIELD_PUBLISHED_COUNT
+};
+
+static volatile unsigned int* getHeader(const void* mapping) {
+    return (volatile unsigned int*)mapping;
+}
+
+static volatile unsigned int* getSlot(const void* mapping, unsigned int slot) {
+    volatile unsigned int* header = getHeader(mapping);
+    return (volatile unsigned int*)((unsigned char*)mapping + ColorExport::HEADER_BYTES +
+        slot * header[FIELD_SLOT_STRIDE]);
+}
+
+ColorExport::ColorExport():
+    valueCount(0),
+    slotCount(0),
+    slotStride(0),
+    byteCount(0),
+    mapping(NULL)
+{
+}
+
+ColorExport::~ColorExport() {
+    this->close();
+}
+
+bool ColorExport::open(const std::string& name, unsigned int valueCount, unsigned int slotCount) {
+    this->close();
+
+#ifdef _WIN32
+    return false;
+#else
+    if (slotCount < 2) slotCount = 2;
+
+  // colors rounded up to whole 64-byte lines, so slots never share one
+    unsigned int colorBytes = (valueCount * sizeof(float) + 63) & ~63u;
+    unsigned int slotStride = SLOT_HEADER_BYTES + colorBytes;
+    size_t byteCount = HEADER_BYTES + (size_t)slotCount * slotStride;
+
+  // readers of a previous run keep the old object until they unmap it
+    shm_unlink(name.c_str());
+
+    int descriptor = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (descriptor < 0) return false;
+
+    void* mapping = MAP_FAILED;
+    if (ftruncate(descriptor, byteCount) == 0)
+        mapping = mmap(NULL, byteCount, PROT_READ | PROT_WRITE, MAP_SHARED, descriptor, 0);
+
+    ::close(descriptor);
+
+    if (mapping == MAP_FAILED) {
+        shm_unlink(name.c_str());
+        return false;
+    }
+
+    this->name = name;
+    this->valueCount = valueCount;
+    this->slotCount = slotCount;
+    this->slotStride = slotStride;
+    this->byteCount = byteCount;
+    this->mapping = (unsigned char*)mapping;
+
+  // ftruncate zero-fills, so every slot starts at sequence 0 and nothing is published
+    volatile unsigned int* header = getHeader(this->mapping);
+    header[FIELD_VERSION] = VERSION;
+    header[FIELD_VALUE_COUNT] = valueCount;
+    header[FIELD_SLOT_COUNT] = slotCount;
+    header[FIELD_SLOT_STRIDE] = slotStride;
+    header[FIELD_PUBLISHED_COUNT] = 0;
+
+  // the magic number goes last, a reader that sees it also sees the layout
+    __sync_synchronize();
+    header[FIELD_MAGIC] = MAGIC;
+
+    return true;
+#endif
+}
+
+void ColorExport::close() {
+    if (this->mapping == NULL) return;
+
+#ifndef _WIN32
+    munmap(this->mapping, this->byteCount);
+    shm_unlink(this->name.c_str());
+#endif
+
+    this->mapping = NULL;
+    this->name.clear();
+}
+
+bool ColorExport::isOpen() const {
+    return this->mapping != NULL;
+}
+
+void ColorExport::publish(const float* colors) {
+    if (this->mapping == NULL) return;
+
+    volatile unsigned int* header = getHeader(this->mapping);
+    unsigned int frame = header[FIELD_PUBLISHED_COUNT];
+    volatile unsigned int* slot = getSlot(this->mapping, frame % this->slotCount);
+
+  // odd while writing, the barriers keep the colors between the two sequence stores
+    slot[0] = 2 * frame + 1;
+    __sync_synchronize();
+
+    memcpy((unsigned char*)slot + SLOT_HEADER_BYTES, colors, this->valueCount * sizeof(float));
+
+    __sync_synchronize();
+    slot[0] = 2 * frame + 2;
+
+    __sync_synchronize();
+    header[FIELD_PUBLISHED_COUNT] = frame + 1;
+}
+
+const float* ColorExport::beginRead(const void* mapping, unsigned int& frame, unsigned int& sequence) {
+    volatile unsigned int* header = getHeader(mapping);
+    if (header[FIELD_MAGIC] != MAGIC) return NULL;
+    __sync_synchronize();
+
+    unsigned int publishedCount = header[FIELD_PUBLISHED_COUNT];
+    if (publishedCount == 0) return NULL;
+
+    frame = publishedCount - 1;
+    __sync_synchronize();
+
+    volatile unsigned int* slot = getSlot(mapping, frame % header[FIELD_SLOT_COUNT]);
+    sequence = slot[0];
+    __sync_synchronize();
+
+    if (sequence != 2 * frame + 2) return NULL;
+
+    return (const float*)((const unsigned char*)slot + SLOT_HEADER_BYTES);
+}
+
+bool ColorExport::endRead(const void* mapping, unsigned int frame, unsigned int sequence) {
+    volatile unsigned int* header = getHeader(mapping);
+    volatile unsigned int* slot = getSlot(mapping, frame % header[FIELD_SLOT_COUNT]);
+
+    __sync_synchronize();
+    return slot[0] == sequence;
+}
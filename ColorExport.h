@@ -0,0 +1,62 @@
+#ifndef _COLOREXPORT_H_
+#define _COLOREXPORT_H_
+
+#include <cstddef>
+#include <string>
+
+/*
+   publishes every frame's vertex colors into a ring of slots in a named POSIX shared memory object,
+   so other processes on the host can map it and read the newest frame in place (Windows builds
+   have no POSIX shared memory, there open always fails)
+
+   layout, every field a 32-bit unsigned integer, every block 64-byte aligned:
+    -header at offset 0: magic, version, valueCount (floats per frame), slotCount, slotStride (bytes),
+     publishedCount (frames published so far, frame f is the f-th, counting from 0)
+    -slot i at HEADER_BYTES + i * slotStride: sequence, then valueCount floats at SLOT_HEADER_BYTES
+   frame f is written to slot f % slotCount, whose sequence is 2f + 1 (odd) while the colors are written
+   and 2f + 2 once they are complete
+
+   readers follow the seqlock protocol through beginRead and endRead:
+    -beginRead picks the newest frame and remembers its slot's sequence
+    -the colors are read straight from the mapping
+    -endRead checks the sequence again, if the writer came round to the slot meanwhile the read is discarded
+   the writer never waits for readers, a reader only retries if it is more than slotCount - 1 frames behind
+*/
+class ColorExport {
+    std::string name;
+    unsigned int valueCount;
+    unsigned int slotCount;
+    unsigned int slotStride;
+    size_t byteCount;
+    unsigned char* mapping;
+
+    ColorExport(const ColorExport&);
+    ColorExport& operator=(const ColorExport&);
+
+public:
+    static const unsigned int MAGIC = 0x53484345;
+    static const unsigned int VERSION = 1;
+    static const unsigned int HEADER_BYTES = 64;
+    static const unsigned int SLOT_HEADER_BYTES = 64;
+
+    ColorExport();
+    ~ColorExport();
+
+  // creates the object (replacing a stale one of the same name, e.g. "/SphericalHarmonicsColors")
+    bool open(const std::string& name, unsigned int valueCount, unsigned int slotCount);
+
+  // unmaps and unlinks, readers keep their own mappings until they unmap
+    void close();
+
+    bool isOpen() const;
+
+  // copies valueCount floats into the next slot
+    void publish(const float* colors);
+
+  // reader side, for a mapping of the whole object
+  // beginRead returns NULL if nothing has been published yet or the newest slot is being rewritten
+    static const float* beginRead(const void* mapping, unsigned int& frame, unsigned int& sequence);
+    static bool endRead(const void* mapping, unsigned int frame, unsigned int sequence);
+};
+
+#endif
@@ -0,0 +1,504 @@
+#include "CompressedTransfer.h"
+
+#include <cmath>
+#include <cstddef>
+#include <cstdlib>
+
+#if defined(__F16C__)
+#include <immintrin.h>
+#endif
+
+// conversion between 32-bit floats and 16-bit halves, no infinity or NaN handling needed here
+
+static inline unsigned short floatToHalf(float value) {
+    union { float f; unsigned int u; } bits;
+    bits.f = value;
+
+    unsigned int sign = (bits.u >> 16) & 0x8000;
+    unsigned int magnitude = bits.u & 0x7fffffff;
+
+  // clamp to largest finite half
+    if (magnitude >= 0x477fe000) return (unsigned short)(sign | 0x7bff);
+
+  // subnormal halves are multiples of 2^-24
+    if (magnitude < 0x38800000) return (unsigned short)(sign | (unsigned int)(fabs(value) * 16777216.f + 0.5f));
+
+  // round mantissa to nearest even, then rebias exponent from 127 to 15
+    magnitude += 0x0fff + ((magnitude >> 13) & 1);
+    return (unsigned short)(sign | ((magnitude - 0x38000000) >> 13));
+}
+
+static inline float halfToFloat(unsigned short half) {
+    union { float f; unsigned int u; } bits;
+
+  // shifting into place and multiplying by 2^112 rebiases exponent and handles subnormals
+    bits.u = (unsigned int)(half & 0x7fff) << 13;
+    bits.f *= 5.192296858534828e+33f;
+    bits.u |= (unsigned int)(half & 0x8000) << 16;
+
+    return bits.f;
+}
+
+#if !defined(__F16C__)
+// every half as a float, built once at startup, for targets without a conversion instruction
+struct HalfTable {
+    float values[65536];
+
+    HalfTable() {
+        for (unsigned int half = 0; half < 65536; half++) values[half] = halfToFloat((unsigned short)half);
+    }
+};
+
+static const HalfTable halfTable;
+#endif
+
+// vertices shaded per batch, the batch's coefficients are converted to floats in one pass per plane
+static const unsigned int SHADE_BATCH_SIZE = 256;
+
+// converts count halves, with F16C eight at a time
+static void convertHalves(const unsigned short* halves, unsigned int count, float* values) {
+    unsigned int iter = 0;
+
+#if defined(__F16C__)
+    for (; iter + 8 <= count; iter += 8)
+        _mm256_storeu_ps(&values[iter], _mm256_cvtph_ps(_mm_loadu_si128((const __m128i*)&halves[iter])));
+
+    for (; iter < count; iter++) values[iter] = halfToFloat(halves[iter]);
+#else
+    for (; iter < count; iter++) values[iter] = halfTable.values[halves[iter]];
+#endif
+}
+
+CompressedTransfer::CompressedTransfer():
+    format(FORMAT_HALF),
+    vertexCount(0),
+    halfPlanes(NULL),
+    bytePlanes(NULL),
+    clusterCount(0),
+    componentCount(0),
+    clusterMeans(NULL),
+    clusterComponents(NULL),
+    clusterIndices(NULL),
+    clusterWeights(NULL)
+{
+    for (int basis = 0; basis < BASIS_FUNCTION_COUNT; basis++) {
+        this->scale[basis] = 0.f;
+        this->bias[basis] = 0.f;
+    }
+}
+
+CompressedTransfer::~CompressedTransfer() {
+    this->release();
+}
+
+void CompressedTransfer::release() {
+    delete[] this->halfPlanes;
+    delete[] this->bytePlanes;
+    delete[] this->clusterMeans;
+    delete[] this->clusterComponents;
+    delete[] this->clusterIndices;
+    delete[] this->clusterWeights;
+
+    this->halfPlanes = NULL;
+    this->bytePlanes = NULL;
+    this->clusterMeans = NULL;
+    this->clusterComponents = NULL;
+    this->clusterIndices = NULL;
+    this->clusterWeights = NULL;
+
+    this->vertexCount = 0;
+    this->clusterCount = 0;
+    this->componentCount = 0;
+}
+
+void CompressedTransfer::compress(const float* transferCoeff, unsigned int vertexCount, Format format,
+    unsigned int clusterCount, unsigned int componentCount)
+{
+    this->release();
+
+    this->format = format;
+    this->vertexCount = vertexCount;
+
+    if (vertexCount == 0) return;
+
+    if (format == FORMAT_CLUSTERED_PCA) {
+      // cluster indices are 16-bit, and there cannot be more clusters than vertices
+        if (clusterCount > 65536) clusterCount = 65536;
+        if (clusterCount > vertexCount) clusterCount = vertexCount;
+        if (clusterCount == 0) clusterCount = 1;
+        if (componentCount > BASIS_FUNCTION_COUNT) componentCount = BASIS_FUNCTION_COUNT;
+
+        this->clusterCount = clusterCount;
+        this->componentCount = componentCount;
+
+        this->clusterPCA(transferCoeff, 16);
+    }
+    else {
+        this->quantize(transferCoeff);
+    }
+}
+
+// each basis is mapped from [minimum,maximum] onto [0,1] before quantisation
+
+void CompressedTransfer::quantize(const float* transferCoeff) {
+    if (this->format == FORMAT_HALF)
+        this->halfPlanes = new unsigned short[BASIS_FUNCTION_COUNT * this->vertexCount];
+    else
+        this->bytePlanes = new unsigned char[BASIS_FUNCTION_COUNT * this->vertexCount];
+
+    for (int basis = 0; basis < BASIS_FUNCTION_COUNT; basis++) {
+        float minimum = transferCoeff[basis];
+        float maximum = transferCoeff[basis];
+
+        for (unsigned int iter = 1; iter < this->vertexCount; iter++) {
+            float value = transferCoeff[BASIS_FUNCTION_COUNT * iter + basis];
+            if (value < minimum) minimum = value;
+            if (value > maximum) maximum = value;
+        }
+
+        float range = maximum - minimum;
+        float inverseRange = (range > 0.f) ? 1.f / range : 0.f;
+
+        this->bias[basis] = minimum;
+        this->scale[basis] = (this->format == FORMAT_HALF) ? range : range / 255.f;
+
+        for (unsigned int iter = 0; iter < this->vertexCount; iter++) {
+            float normalized = (transferCoeff[BASIS_FUNCTION_COUNT * iter + basis] - minimum) * inverseRange;
+
+            if (this->format == FORMAT_HALF)
+                this->halfPlanes[basis * this->vertexCount + iter] = floatToHalf(normalized);
+            else
+                this->bytePlanes[basis * this->vertexCount + iter] = (unsigned char)(normalized * 255.f + 0.5f);
+        }
+    }
+}
+
+/*
+   k-means clustering of the coefficient vectors followed by PCA of every cluster
+   clusters start from evenly spaced vertices so results are repeatable,
+   and principal components are found by power iteration with deflation
+*/
+void CompressedTransfer::clusterPCA(const float* transferCoeff, unsigned int iterationCount) {
+    unsigned int clusterStride = BASIS_FUNCTION_COUNT;
+    unsigned int componentStride = BASIS_FUNCTION_COUNT * this->componentCount;
+
+    this->clusterMeans = new float[clusterStride * this->clusterCount];
+    this->clusterComponents = new float[componentStride * this->clusterCount];
+    this->clusterIndices = new unsigned short[this->vertexCount];
+    this->clusterWeights = new float[this->componentCount * this->vertexCount];
+
+    for (unsigned int cluster = 0; cluster < this->clusterCount; cluster++) {
+        unsigned int seed = (unsigned int)((double)cluster * this->vertexCount / this->clusterCount);
+        for (int basis = 0; basis < BASIS_FUNCTION_COUNT; basis++)
+            this->clusterMeans[clusterStride * cluster + basis] = transferCoeff[BASIS_FUNCTION_COUNT * seed + basis];
+    }
+
+    double* sums = new double[clusterStride * this->clusterCount];
+    unsigned int* memberCounts = new unsigned int[this->clusterCount];
+
+    for (unsigned int iteration = 0; iteration < iterationCount; iteration++) {
+        bool changed = false;
+
+      // assign every vertex to its nearest cluster mean
+        for (unsigned int iter = 0; iter < this->vertexCount; iter++) {
+            const float* coefficients = &transferCoeff[BASIS_FUNCTION_COUNT * iter];
+
+            unsigned int nearest = 0;
+            float nearestDistance = 0.f;
+
+            for (unsigned int cluster = 0; cluster < this->clusterCount; cluster++) {
+                const float* mean = &this->clusterMeans[clusterStride * cluster];
+
+                float distance = 0.f;
+                for (int basis = 0; basis < BASIS_FUNCTION_COUNT; basis++) {
+                    float difference = coefficients[basis] - mean[basis];
+                    distance += difference * difference;
+                }
+
+                if (cluster == 0 || distance < nearestDistance) {
+                    nearest = cluster;
+                    nearestDistance = distance;
+                }
+            }
+
+            if (iteration == 0 || this->clusterIndices[iter] != nearest) changed = true;
+            this->clusterIndices[iter] = (unsigned short)nearest;
+        }
+
+        if (!changed) break;
+
+      // move every mean to the centroid of its members, empty clusters keep their old mean
+        for (unsigned int iter = 0; iter < clusterStride * this->clusterCount; iter++) sums[iter] = 0.0;
+        for (unsigned int cluster = 0; cluster < this->clusterCount; cluster++) memberCounts[cluster] = 0;
+
+        for (unsigned int iter = 0; iter < this->vertexCount; iter++) {
+            unsigned int cluster = this->clusterIndices[iter];
+            memberCounts[cluster]++;
+            for (int basis = 0; basis < BASIS_FUNCTION_COUNT; basis++)
+                sums[clusterStride * cluster + basis] += transferCoeff[BASIS_FUNCTION_COUNT * iter + basis];
+        }
+
+        for (unsigned int cluster = 0; cluster < this->clusterCount; cluster++) {
+            if (memberCounts[cluster] == 0) continue;
+            for (int basis = 0; basis < BASIS_FUNCTION_COUNT; basis++)
+                this->clusterMeans[clusterStride * cluster + basis] =
+                    (float)(sums[clusterStride * cluster + basis] / memberCounts[cluster]);
+        }
+    }
+
+    delete[] sums;
+    delete[] memberCounts;
+
+  // covariance matrices of every cluster around its mean
+    const int matrixSize = BASIS_FUNCTION_COUNT * BASIS_FUNCTION_COUNT;
+    double* covariances = new double[matrixSize * this->clusterCount];
+    for (unsigned int iter = 0; iter < matrixSize * this->clusterCount; iter++) covariances[iter] = 0.0;
+
+    for (unsigned int iter = 0; iter < this->vertexCount; iter++) {
+        unsigned int cluster = this->clusterIndices[iter];
+        const float* mean = &this->clusterMeans[clusterStride * cluster];
+        double* covariance = &covariances[matrixSize * cluster];
+
+        double difference[BASIS_FUNCTION_COUNT];
+        for (int basis = 0; basis < BASIS_FUNCTION_COUNT; basis++)
+            difference[basis] = transferCoeff[BASIS_FUNCTION_COUNT * iter + basis] - mean[basis];
+
+        for (int row = 0; row < BASIS_FUNCTION_COUNT; row++) {
+            for (int column = 0; column < BASIS_FUNCTION_COUNT; column++)
+                covariance[BASIS_FUNCTION_COUNT * row + column] += difference[row] * difference[column];
+        }
+    }
+
+    for (unsigned int cluster = 0; cluster < this->clusterCount; cluster++) {
+        double* covariance = &covariances[matrixSize * cluster];
+        float* components = &this->clusterComponents[componentStride * cluster];
+
+        for (unsigned int component = 0; component < this->componentCount; component++) {
+            double vector[BASIS_FUNCTION_COUNT];
+            for (int basis = 0; basis < BASIS_FUNCTION_COUNT; basis++) vector[basis] = 1.0 / (basis + 1);
+
+            double eigenvalue = 0.0;
+
+            for (int powerIter = 0; powerIter < 64; powerIter++) {
+                double product[BASIS_FUNCTION_COUNT];
+                double length = 0.0;
+
+                for (int row = 0; row < BASIS_FUNCTION_COUNT; row++) {
+                    product[row] = 0.0;
+                    for (int column = 0; column < BASIS_FUNCTION_COUNT; column++)
+                        product[row] += covariance[BASIS_FUNCTION_COUNT * row + column] * vector[column];
+                    length += product[row] * product[row];
+                }
+
+                length = sqrt(length);
+                eigenvalue = length;
+                if (length <= 0.0) break;
+
+                for (int basis = 0; basis < BASIS_FUNCTION_COUNT; basis++) vector[basis] = product[basis] / length;
+            }
+
+          // a cluster without remaining variance gets zero components
+            if (eigenvalue <= 0.0) {
+                for (int basis = 0; basis < BASIS_FUNCTION_COUNT; basis++) vector[basis] = 0.0;
+            }
+
+            for (int basis = 0; basis < BASIS_FUNCTION_COUNT; basis++)
+                components[BASIS_FUNCTION_COUNT * component + basis] = (float)vector[basis];
+
+          // deflate so the next power iteration finds the next largest component
+            for (int row = 0; row < BASIS_FUNCTION_COUNT; row++) {
+                for (int column = 0; column < BASIS_FUNCTION_COUNT; column++)
+                    covariance[BASIS_FUNCTION_COUNT * row + column] -= eigenvalue * vector[row] * vector[column];
+            }
+        }
+    }
+
+    delete[] covariances;
+
+  // per-vertex weights are projections of the offset from the cluster mean onto each component
+    for (unsigned int iter = 0; iter < this->vertexCount; iter++) {
+        unsigned int cluster = this->clusterIndices[iter];
+        const float* mean = &this->clusterMeans[clusterStride * cluster];
+        const float* components = &this->clusterComponents[componentStride * cluster];
+
+        for (unsigned int component = 0; component < this->componentCount; component++) {
+            float weight = 0.f;
+            for (int basis = 0; basis < BASIS_FUNCTION_COUNT; basis++) {
+                weight += (transferCoeff[BASIS_FUNCTION_COUNT * iter + basis] - mean[basis]) *
+                    components[BASIS_FUNCTION_COUNT * component + basis];
+            }
+            this->clusterWeights[this->componentCount * iter + component] = weight;
+        }
+    }
+}
+
+void CompressedTransfer::decompress(unsigned int vertex, float* coefficients) const {
+    if (this->format == FORMAT_CLUSTERED_PCA) {
+        unsigned int cluster = this->clusterIndices[vertex];
+        const float* mean = &this->clusterMeans[BASIS_FUNCTION_COUNT * cluster];
+        const float* components = &this->clusterComponents[BASIS_FUNCTION_COUNT * this->componentCount * cluster];
+        const float* weights = &this->clusterWeights[this->componentCount * vertex];
+
+        for (int basis = 0; basis < BASIS_FUNCTION_COUNT; basis++) {
+            coefficients[basis] = mean[basis];
+            for (unsigned int component = 0; component < this->componentCount; component++)
+                coefficients[basis] += weights[component] * components[BASIS_FUNCTION_COUNT * component + basis];
+        }
+    }
+    else if (this->format == FORMAT_HALF) {
+        for (int basis = 0; basis < BASIS_FUNCTION_COUNT; basis++) {
+            coefficients[basis] = this->bias[basis] + this->scale[basis] *
+                halfToFloat(this->halfPlanes[basis * this->vertexCount + vertex]);
+        }
+    }
+    else {
+        for (int basis = 0; basis < BASIS_FUNCTION_COUNT; basis++) {
+            coefficients[basis] = this->bias[basis] + this->scale[basis] *
+                (float)this->bytePlanes[basis * this->vertexCount + vertex];
+        }
+    }
+}
+
+CompressedTransferError CompressedTransfer::calculateError(const float* transferCoeff) const {
+    CompressedTransferError error;
+    error.maximumError = 0.f;
+    error.rmsError = 0.f;
+    error.byteCount = this->getByteCount();
+    error.uncompressedByteCount = BASIS_FUNCTION_COUNT * (size_t)this->vertexCount * sizeof(float);
+
+    double squaredSum = 0.0;
+
+    for (unsigned int iter = 0; iter < this->vertexCount; iter++) {
+        float coefficients[BASIS_FUNCTION_COUNT];
+        this->decompress(iter, coefficients);
+
+        for (int basis = 0; basis < BASIS_FUNCTION_COUNT; basis++) {
+            float difference = fabs(coefficients[basis] - transferCoeff[BASIS_FUNCTION_COUNT * iter + basis]);
+            if (difference > error.maximumError) error.maximumError = difference;
+            squaredSum += difference * difference;
+        }
+    }
+
+    if (this->vertexCount > 0)
+        error.rmsError = (float)sqrt(squaredSum / (BASIS_FUNCTION_COUNT * this->vertexCount));
+
+    return error;
+}
+
+/*
+   shading is linear in the transfer coefficients, so scale and bias (or cluster means and components)
+   are folded into the lighting once per call, leaving only a short dot product per vertex
+*/
+void CompressedTransfer::shade(const sf::Vector3f* lightSHCoeff, float* modelColors) const {
+    if (this->format == FORMAT_CLUSTERED_PCA) {
+        unsigned int lightStride = this->componentCount + 1;
+        sf::Vector3f* clusterLight = new sf::Vector3f[lightStride * this->clusterCount];
+
+        for (unsigned int cluster = 0; cluster < this->clusterCount; cluster++) {
+            const float* mean = &this->clusterMeans[BASIS_FUNCTION_COUNT * cluster];
+            const float* components = &this->clusterComponents[BASIS_FUNCTION_COUNT * this->componentCount * cluster];
+
+            sf::Vector3f* light = &clusterLight[lightStride * cluster];
+            for (unsigned int iter = 0; iter < lightStride; iter++) light[iter] = sf::Vector3f(0.f, 0.f, 0.f);
+
+            for (int basis = 0; basis < BASIS_FUNCTION_COUNT; basis++) {
+                light[0] += lightSHCoeff[basis] * mean[basis];
+                for (unsigned int component = 0; component < this->componentCount; component++)
+                    light[component + 1] += lightSHCoeff[basis] * components[BASIS_FUNCTION_COUNT * component + basis];
+            }
+        }
+
+        for (unsigned int iter = 0; iter < this->vertexCount; iter++) {
+            const sf::Vector3f* light = &clusterLight[lightStride * this->clusterIndices[iter]];
+            const float* weights = &this->clusterWeights[this->componentCount * iter];
+
+            float red = light[0].x, green = light[0].y, blue = light[0].z;
+            for (unsigned int component = 0; component < this->componentCount; component++) {
+                red += weights[component] * light[component + 1].x;
+                green += weights[component] * light[component + 1].y;
+                blue += weights[component] * light[component + 1].z;
+            }
+
+            modelColors[3 * iter + 0] = red;
+            modelColors[3 * iter + 1] = green;
+            modelColors[3 * iter + 2] = blue;
+        }
+
+        delete[] clusterLight;
+        return;
+    }
+
+    sf::Vector3f constantColor(0.f, 0.f, 0.f);
+    sf::Vector3f scaledLight[BASIS_FUNCTION_COUNT];
+
+    for (int basis = 0; basis < BASIS_FUNCTION_COUNT; basis++) {
+        constantColor += lightSHCoeff[basis] * this->bias[basis];
+        scaledLight[basis] = lightSHCoeff[basis] * this->scale[basis];
+    }
+
+    if (this->format == FORMAT_HALF) {
+        float values[BASIS_FUNCTION_COUNT][SHADE_BATCH_SIZE];
+
+        for (unsigned int batchStart = 0; batchStart < this->vertexCount; batchStart += SHADE_BATCH_SIZE) {
+            unsigned int batchSize = this->vertexCount - batchStart;
+            if (batchSize > SHADE_BATCH_SIZE) batchSize = SHADE_BATCH_SIZE;
+
+            for (int basis = 0; basis < BASIS_FUNCTION_COUNT; basis++)
+                convertHalves(&this->halfPlanes[basis * this->vertexCount + batchStart], batchSize, values[basis]);
+
+            for (unsigned int batchIter = 0; batchIter < batchSize; batchIter++) {
+                float red = constantColor.x, green = constantColor.y, blue = constantColor.z;
+
+                for (int basis = 0; basis < BASIS_FUNCTION_COUNT; basis++) {
+                    float value = values[basis][batchIter];
+                    red += scaledLight[basis].x * value;
+                    green += scaledLight[basis].y * value;
+                    blue += scaledLight[basis].z * value;
+                }
+
+                unsigned int iter = batchStart + batchIter;
+                modelColors[3 * iter + 0] = red;
+                modelColors[3 * iter + 1] = green;
+                modelColors[3 * iter + 2] = blue;
+            }
+        }
+
+        return;
+    }
+
+    for (unsigned int iter = 0; iter < this->vertexCount; iter++) {
+        float red = constantColor.x, green = constantColor.y, blue = constantColor.z;
+
+        for (int basis = 0; basis < BASIS_FUNCTION_COUNT; basis++) {
+            float value = (float)this->bytePlanes[basis * this->vertexCount + iter];
+            red += scaledLight[basis].x * value;
+            green += scaledLight[basis].y * value;
+            blue += scaledLight[basis].z * value;
+        }
+
+        modelColors[3 * iter + 0] = red;
+        modelColors[3 * iter + 1] = green;
+        modelColors[3 * iter + 2] = blue;
+    }
+}
+
+CompressedTransfer::Format CompressedTransfer::getFormat() const {
+    return this->format;
+}
+
+unsigned int CompressedTransfer::getVertexCount() const {
+    return this->vertexCount;
+}
+
+size_t CompressedTransfer::getByteCount() const {
+    size_t vertexCount = this->vertexCount;
+
+    if (this->format == FORMAT_CLUSTERED_PCA) {
+        return BASIS_FUNCTION_COUNT * (size_t)(this->componentCount + 1) * this->clusterCount * sizeof(float) +
+            vertexCount * sizeof(unsigned short) +
+            this->componentCount * vertexCount * sizeof(float);
+    }
+
+    size_t planeBytes = (this->format == FORMAT_HALF) ? sizeof(unsigned short) : sizeof(unsigned char);
+    return BASIS_FUNCTION_COUNT * vertexCount * planeBytes + 2 * BASIS_FUNCTION_COUNT * sizeof(float);
+}
@@ -0,0 +1,78 @@
+#ifndef _COMPRESSEDTRANSFER_H_
+#define _COMPRESSEDTRANSFER_H_
+
+#include "SphericalHarmonics.h"
+
+#include <cstddef>
+
+#include <SFML/System/Vector3.hpp>
+
+// error of compressed transfer coefficients compared to the original floats
+struct CompressedTransferError {
+    float maximumError;
+    float rmsError;
+    size_t byteCount;
+    size_t uncompressedByteCount;
+};
+
+/*
+   compact storage for per-vertex transfer coefficients (BASIS_FUNCTION_COUNT floats per vertex)
+    -FORMAT_HALF and FORMAT_BYTE store one quantised plane per basis with a scale and bias
+    -FORMAT_CLUSTERED_PCA stores a few cluster means and components plus per-vertex weights,
+      so shading only needs a handful of dot products per cluster and per vertex
+*/
+class CompressedTransfer {
+public:
+    enum Format {
+        FORMAT_HALF,
+        FORMAT_BYTE,
+        FORMAT_CLUSTERED_PCA
+    };
+
+private:
+    Format format;
+    unsigned int vertexCount;
+
+  // quantised planes, vertexCount values per basis, stored one basis after another
+    unsigned short* halfPlanes;
+    unsigned char* bytePlanes;
+    float scale[BASIS_FUNCTION_COUNT];
+    float bias[BASIS_FUNCTION_COUNT];
+
+  // clustered PCA, components are stored componentCount per cluster
+    unsigned int clusterCount;
+    unsigned int componentCount;
+    float* clusterMeans;
+    float* clusterComponents;
+    unsigned short* clusterIndices;
+    float* clusterWeights;
+
+    void release();
+    void quantize(const float* transferCoeff);
+    void clusterPCA(const float* transferCoeff, unsigned int iterationCount);
+
+  // copying would share the planes, not supported
+    CompressedTransfer(const CompressedTransfer&);
+    CompressedTransfer& operator=(const CompressedTransfer&);
+
+public:
+    CompressedTransfer();
+    ~CompressedTransfer();
+
+    void compress(const float* transferCoeff, unsigned int vertexCount, Format format,
+        unsigned int clusterCount = 32, unsigned int componentCount = 4);
+
+  // reconstructs the BASIS_FUNCTION_COUNT coefficients of a single vertex
+    void decompress(unsigned int vertex, float* coefficients) const;
+
+    CompressedTransferError calculateError(const float* transferCoeff) const;
+
+  // computes 3 floats of color per vertex from already rotated and normalized lighting coefficients
+    void shade(const sf::Vector3f* lightSHCoeff, float* modelColors) const;
+
+    Format getFormat() const;
+    unsigned int getVertexCount() const;
+    size_t getByteCount() const;
+};
+
+#endif
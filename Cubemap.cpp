@@ -2,6 +2,20 @@
 
 #include <cmath>
 
+#include <pthread.h>
+
+struct DecodeFaceParameters {
+    SoftwareTextureSFML* face;
+    std::string filePath;
+    bool success;
+};
+
+void* decodeFaceThreaded(void* input) {
+    DecodeFaceParameters* parameters = (DecodeFaceParameters*)input;
+    parameters->success = parameters->face->loadFromFile(parameters->filePath);
+    return NULL;
+}
+
 const float Cubemap::texCoordPointer[48] = {
   // negative X face
     0.f, 0.f,
@@ -98,16 +112,50 @@ const unsigned int Cubemap::positiveZIndexPointer[4] = {
 Cubemap::Cubemap() {
 }
 
-// might want to add loading functions for individual faces
+Cubemap::Cubemap(const std::string& directory) {
+    this->loadFromDirectory(directory);
+}
+
+bool Cubemap::loadFromDirectory(const std::string& directory) {
+  // same order as Face
+    SoftwareTextureSFML* faces[6] = {
+        &this->negativeX, &this->positiveX, &this->negativeY, &this->positiveY, &this->negativeZ, &this->positiveZ
+    };
+    const char* faceNames[6] = {
+        "negativeX.png", "positiveX.png", "negativeY.png", "positiveY.png", "negativeZ.png", "positiveZ.png"
+    };
+
+    pthread_t threadArray[6];
+    DecodeFaceParameters inputArray[6];
 
-Cubemap::Cubemap(const std::string& directory):
-    negativeX(directory + "/negativeX.png"),
-    positiveX(directory + "/positiveX.png"),
-    negativeY(directory + "/negativeY.png"),
-    positiveY(directory + "/positiveY.png"),
-    negativeZ(directory + "/negativeZ.png"),
-    positiveZ(directory + "/positiveZ.png")
-{
+    for (int face = 0; face < 6; face++) {
+        inputArray[face].face = faces[face];
+        inputArray[face].filePath = directory + "/" + faceNames[face];
+        inputArray[face].success = false;
+
+        pthread_create(&threadArray[face], NULL, decodeFaceThreaded, (void*)&inputArray[face]);
+    }
+
+    bool success = true;
+    for (int face = 0; face < 6; face++) {
+        pthread_join(threadArray[face], NULL);
+        success = success && inputArray[face].success;
+    }
+
+    return success;
+}
+
+bool Cubemap::uploadTextures() {
+    bool success = true;
+
+    success = this->negativeX.upload() && success;
+    success = this->positiveX.upload() && success;
+    success = this->negativeY.upload() && success;
+    success = this->positiveY.upload() && success;
+    success = this->negativeZ.upload() && success;
+    success = this->positiveZ.upload() && success;
+
+    return success;
 }
 
 const sf::Texture* Cubemap::getNegativeXTexturePointer() const {
@@ -167,51 +215,67 @@ const unsigned int* Cubemap::getPositiveZIndexPointer() {
 }
 
 sf::Vector3f Cubemap::getColorFromTexCoords(const sf::Vector3f& texCoords) const {
-    sf::Vector3f finalColor;
+    sf::Vector2f faceTexCoords;
+
+    switch (Cubemap::getFaceFromTexCoords(texCoords, faceTexCoords)) {
+        case NEGATIVE_X: return this->negativeX.getColorFromTexCoords(faceTexCoords);
+        case POSITIVE_X: return this->positiveX.getColorFromTexCoords(faceTexCoords);
+        case NEGATIVE_Y: return this->negativeY.getColorFromTexCoords(faceTexCoords);
+        case POSITIVE_Y: return this->positiveY.getColorFromTexCoords(faceTexCoords);
+        case NEGATIVE_Z: return this->negativeZ.getColorFromTexCoords(faceTexCoords);
+        default: return this->positiveZ.getColorFromTexCoords(faceTexCoords);
+    }
+}
+
+Cubemap::Face Cubemap::getFaceFromTexCoords(const sf::Vector3f& texCoords, sf::Vector2f& faceTexCoords) {
+    Face face;
 
     float maximum = fabs(texCoords.x);
     if (fabs(texCoords.y) > maximum) maximum = fabs(texCoords.y);
     if (fabs(texCoords.z) > maximum) maximum = fabs(texCoords.z);
 
     if (maximum == fabs(texCoords.x)) {
-        sf::Vector2f faceTexCoords(texCoords.z, -texCoords.y);
+        faceTexCoords = sf::Vector2f(texCoords.z, -texCoords.y);
         faceTexCoords /= (float)fabs(texCoords.x);
 
         if (texCoords.x < 0.f) faceTexCoords.x = -faceTexCoords.x;
 
-        faceTexCoords = 0.5f * faceTexCoords + sf::Vector2f(0.5f, 0.5f);
-
-        if (texCoords.x < 0.f)
-            finalColor = this->negativeX.getColorFromTexCoords(faceTexCoords);
-        else
-            finalColor = this->positiveX.getColorFromTexCoords(faceTexCoords);
+        face = (texCoords.x < 0.f) ? NEGATIVE_X : POSITIVE_X;
     }
     else if (maximum == fabs(texCoords.y)) {
-        sf::Vector2f faceTexCoords(texCoords.x, -texCoords.z);
+        faceTexCoords = sf::Vector2f(texCoords.x, -texCoords.z);
         faceTexCoords /= (float)fabs(texCoords.y);
 
         if (texCoords.y < 0.f) faceTexCoords.y = -faceTexCoords.y;
 
-        faceTexCoords = 0.5f * faceTexCoords + sf::Vector2f(0.5f, 0.5f);
-
-        if (texCoords.y < 0.f)
-            finalColor = this->negativeY.getColorFromTexCoords(faceTexCoords);
-        else
-            finalColor = this->positiveY.getColorFromTexCoords(faceTexCoords);
+        face = (texCoords.y < 0.f) ? NEGATIVE_Y : POSITIVE_Y;
     }
-    else if (maximum == fabs(texCoords.z)) {
-        sf::Vector2f faceTexCoords(texCoords.x, -texCoords.y);
+    else {
+        faceTexCoords = sf::Vector2f(texCoords.x, -texCoords.y);
         faceTexCoords /= (float)fabs(texCoords.z);
 
         if (texCoords.z > 0.f) faceTexCoords.x = -faceTexCoords.x;
 
-        faceTexCoords = 0.5f * faceTexCoords + sf::Vector2f(0.5f, 0.5f);
-
-        if (texCoords.z < 0.f)
-            finalColor = this->negativeZ.getColorFromTexCoords(faceTexCoords);
-        else
-            finalColor = this->positiveZ.getColorFromTexCoords(faceTexCoords);
+        face = (texCoords.z < 0.f) ? NEGATIVE_Z : POSITIVE_Z;
     }
 
-    return finalColor;
+    faceTexCoords = 0.5f * faceTexCoords + sf::Vector2f(0.5f, 0.5f);
+
+    return face;
+}
+
+// inverse of getFaceFromTexCoords, the result lies on the unit cube rather than the unit sphere
+
+sf::Vector3f Cubemap::getTexCoordsFromFace(Face face, const sf::Vector2f& faceTexCoords) {
+    float s = 2.f * faceTexCoords.x - 1.f;
+    float t = 2.f * faceTexCoords.y - 1.f;
+
+    switch (face) {
+        case NEGATIVE_X: return sf::Vector3f(-1.f, -t, -s);
+        case POSITIVE_X: return sf::Vector3f(1.f, -t, s);
+        case NEGATIVE_Y: return sf::Vector3f(s, -1.f, t);
+        case POSITIVE_Y: return sf::Vector3f(s, 1.f, -t);
+        case NEGATIVE_Z: return sf::Vector3f(s, -t, -1.f);
+        default: return sf::Vector3f(-s, -t, 1.f);
+    }
 }
@@ -3,6 +3,8 @@
 
 #include "SoftwareTextureSFML.h"
 
+#include <string>
+
 class Cubemap {
     SoftwareTextureSFML negativeX;
     SoftwareTextureSFML positiveX;
@@ -22,9 +24,25 @@ class Cubemap {
     static const unsigned int positiveZIndexPointer[4];
 
 public:
+  // face order matches the vertex and index pointers
+    enum Face {
+        NEGATIVE_X,
+        POSITIVE_X,
+        NEGATIVE_Y,
+        POSITIVE_Y,
+        NEGATIVE_Z,
+        POSITIVE_Z
+    };
+
     Cubemap();
     Cubemap(const std::string& directory);
 
+  // decodes the six faces concurrently, one thread each, returns false if any face failed
+    bool loadFromDirectory(const std::string& directory);
+
+  // creates the textures used for drawing, needs an active OpenGL context
+    bool uploadTextures();
+
     const sf::Texture* getNegativeXTexturePointer() const;
     const sf::Texture* getPositiveXTexturePointer() const;
     const sf::Texture* getNegativeYTexturePointer() const;
@@ -44,6 +62,10 @@ public:
 
   // should this be a const function?
     sf::Vector3f getColorFromTexCoords(const sf::Vector3f& texCoords) const;
+
+  // face addressing shared with other cubemap-shaped data, face coordinates are in [0,1]x[0,1]
+    static Face getFaceFromTexCoords(const sf::Vector3f& texCoords, sf::Vector2f& faceTexCoords);
+    static sf::Vector3f getTexCoordsFromFace(Face face, const sf::Vector2f& faceTexCoords);
 };
 
 #endif
@@ -0,0 +1,180 @@
+#include "CubemapProjection.h"
+#include "SphericalHarmonics.h"
+
+#include <vector>
+
+#include <pthread.h>
+
+void calculateCubemapCoefficients(Cubemap& cubemap, unsigned int thetaResolution, unsigned int phiResolution,
+    sf::Vector3f* cubemapSHCoeff, int threadCount)
+{
+    SphericalQuadrature quadrature(thetaResolution, phiResolution);
+    calculateCubemapCoefficients(cubemap, quadrature, cubemapSHCoeff, threadCount);
+}
+
+// theta rows per block, part of the result, so changing it changes the last bits
+static const unsigned int INTEGRATION_BLOCK_ROWS = 4;
+
+// range of blocks handed to one thread, with BASIS_FUNCTION_COUNT sums per block
+struct ProjectCubemapBlocksParameters {
+    const Cubemap* cubemap;
+    const SphericalQuadrature* quadrature;
+    unsigned int startBlock;
+    unsigned int endBlock;
+    sf::Vector3f* blockSums;
+};
+
+// one row at a time: every texel is looked up once and the basis block kernel evaluates the whole row
+void* projectCubemapBlocksThreaded(void* input) {
+    ProjectCubemapBlocksParameters* parameters = (ProjectCubemapBlocksParameters*)input;
+    const SphericalQuadrature& quadrature = *parameters->quadrature;
+    unsigned int phiResolution = quadrature.phiResolution;
+
+    std::vector<float> x(phiResolution), y(phiResolution), z(phiResolution);
+    std::vector<float> basisValues(BASIS_FUNCTION_COUNT * phiResolution);
+    std::vector<sf::Vector3f> colors(phiResolution);
+
+    for (unsigned int block = parameters->startBlock; block < parameters->endBlock; block++) {
+        sf::Vector3f* sums = &parameters->blockSums[BASIS_FUNCTION_COUNT * block];
+        for (int basis = 0; basis < BASIS_FUNCTION_COUNT; basis++) sums[basis] = sf::Vector3f(0.f, 0.f, 0.f);
+
+        unsigned int startRow = block * INTEGRATION_BLOCK_ROWS;
+        unsigned int endRow = startRow + INTEGRATION_BLOCK_ROWS;
+        if (endRow > quadrature.thetaResolution) endRow = quadrature.thetaResolution;
+
+        for (unsigned int thetaIter = startRow; thetaIter < endRow; thetaIter++) {
+            for (unsigned int phiIter = 0; phiIter < phiResolution; phiIter++) {
+                x[phiIter] = quadrature.sinTheta[thetaIter] * quadrature.sinPhi[phiIter];
+                y[phiIter] = quadrature.cosTheta[thetaIter];
+                z[phiIter] = quadrature.sinTheta[thetaIter] * quadrature.cosPhi[phiIter];
+
+                colors[phiIter] = parameters->cubemap->getColorFromTexCoords(
+                    sf::Vector3f(x[phiIter], y[phiIter], z[phiIter]));
+            }
+
+            calculateHarmonicBasisBlock(phiResolution, &x[0], &y[0], &z[0], &basisValues[0], phiResolution);
+
+            for (int basis = 0; basis < BASIS_FUNCTION_COUNT; basis++) {
+                const float* values = &basisValues[basis * phiResolution];
+                sf::Vector3f rowSum(0.f, 0.f, 0.f);
+
+                for (unsigned int phiIter = 0; phiIter < phiResolution; phiIter++)
+                    rowSum += colors[phiIter] * values[phiIter];
+
+                sums[basis] += rowSum;
+            }
+        }
+    }
+
+    return NULL;
+}
+
+/*
+   all basis functions are projected in a single pass over the quadrature, sharing the texel look-ups
+   the theta rows are split into fixed blocks, whichever thread sums them, and the block sums are added
+   pairwise (0+1, 2+3, ..., then 0+2, ...), so the coefficients are bit-identical for any thread count
+   and rounding error grows with the logarithm of the sample count instead of linearly
+*/
+void calculateCubemapCoefficients(Cubemap& cubemap, const SphericalQuadrature& quadrature,
+    sf::Vector3f* cubemapSHCoeff, int threadCount)
+{
+    unsigned int blockCount = (quadrature.thetaResolution + INTEGRATION_BLOCK_ROWS - 1) / INTEGRATION_BLOCK_ROWS;
+    if (blockCount == 0 || quadrature.phiResolution == 0) {
+        for (int basis = 0; basis < BASIS_FUNCTION_COUNT; basis++) cubemapSHCoeff[basis] = sf::Vector3f(0.f, 0.f, 0.f);
+        return;
+    }
+
+    if (threadCount < 1) threadCount = 1;
+    if ((unsigned int)threadCount > blockCount) threadCount = blockCount;
+
+    std::vector<sf::Vector3f> blockSums(BASIS_FUNCTION_COUNT * blockCount);
+    std::vector<pthread_t> threadArray(threadCount);
+    std::vector<ProjectCubemapBlocksParameters> inputArray(threadCount);
+
+    for (int threadIndex = 0; threadIndex < threadCount; threadIndex++) {
+        ProjectCubemapBlocksParameters* input = &inputArray[threadIndex];
+
+        input->cubemap = &cubemap;
+        input->quadrature = &quadrature;
+        input->startBlock = (threadIndex + 0) * blockCount / threadCount;
+        input->endBlock = (threadIndex + 1) * blockCount / threadCount;
+        input->blockSums = &blockSums[0];
+    }
+
+    for (int threadIndex = 1; threadIndex < threadCount; threadIndex++)
+        pthread_create(&threadArray[threadIndex], NULL, projectCubemapBlocksThreaded, (void*)&inputArray[threadIndex]);
+
+    projectCubemapBlocksThreaded((void*)&inputArray[0]);
+
+    for (int threadIndex = 1; threadIndex < threadCount; threadIndex++)
+        pthread_join(threadArray[threadIndex], NULL);
+
+    for (unsigned int stride = 1; stride < blockCount; stride *= 2) {
+        for (unsigned int block = 0; block + stride < blockCount; block += 2 * stride) {
+            for (int basis = 0; basis < BASIS_FUNCTION_COUNT; basis++)
+                blockSums[BASIS_FUNCTION_COUNT * block + basis] += blockSums[BASIS_FUNCTION_COUNT * (block + stride) + basis];
+        }
+    }
+
+    for (int basis = 0; basis < BASIS_FUNCTION_COUNT; basis++) {
+        cubemapSHCoeff[basis] = blockSums[basis];
+        cubemapSHCoeff[basis] *= 1.f / (float)(quadrature.thetaResolution * quadrature.phiResolution);
+        cubemapSHCoeff[basis] *= (float)(4.f * M_PI);
+    }
+}
+
+// coefficients of every basis function at once, so a single refinement serves all of them
+struct CubemapProjectionValue {
+    sf::Vector3f coefficients[BASIS_FUNCTION_COUNT];
+
+    CubemapProjectionValue& operator+=(const CubemapProjectionValue& value) {
+        for (int basis = 0; basis < BASIS_FUNCTION_COUNT; basis++) this->coefficients[basis] += value.coefficients[basis];
+        return *this;
+    }
+
+    CubemapProjectionValue& operator*=(float factor) {
+        for (int basis = 0; basis < BASIS_FUNCTION_COUNT; basis++) this->coefficients[basis] *= factor;
+        return *this;
+    }
+};
+
+// euclidean norm over every basis function and channel, so a patch is refined for the set as a whole
+inline float sphericalFunctionMagnitude(const CubemapProjectionValue& value) {
+    float squaredNorm = 0.f;
+    for (int basis = 0; basis < BASIS_FUNCTION_COUNT; basis++) {
+        const sf::Vector3f& coefficient = value.coefficients[basis];
+        squaredNorm += coefficient.x * coefficient.x + coefficient.y * coefficient.y + coefficient.z * coefficient.z;
+    }
+    return sqrt(squaredNorm);
+}
+
+// cubemap multiplied by every basis function, with one texel look-up per direction
+class SphericalFunctionCubemapProjection : public SphericalFunction<CubemapProjectionValue> {
+    Cubemap& cubemap;
+public:
+    SphericalFunctionCubemapProjection(Cubemap& cubemap) :
+        cubemap(cubemap)
+    {
+    }
+    CubemapProjectionValue getValue(const sf::Vector3f& v) {
+        sf::Vector3f color = cubemap.getColorFromTexCoords(v);
+
+        float basisValues[BASIS_FUNCTION_COUNT];
+        calculateHarmonicBasisBlock(1, &v.x, &v.y, &v.z, basisValues, 1);
+
+        CubemapProjectionValue value;
+        for (int basis = 0; basis < BASIS_FUNCTION_COUNT; basis++) value.coefficients[basis] = color * basisValues[basis];
+        return value;
+    }
+};
+
+float calculateCubemapCoefficientsAdaptive(Cubemap& cubemap, float tolerance, sf::Vector3f* cubemapSHCoeff) {
+    SphericalFunctionCubemapProjection projection(cubemap);
+
+    float errorEstimate = 0.f;
+    CubemapProjectionValue integral = projection.integrateAdaptive(tolerance, errorEstimate);
+
+    for (int basis = 0; basis < BASIS_FUNCTION_COUNT; basis++) cubemapSHCoeff[basis] = integral.coefficients[basis];
+
+    return errorEstimate;
+}
@@ -0,0 +1,31 @@
+#ifndef _CUBEMAPPROJECTION_H_
+#define _CUBEMAPPROJECTION_H_
+
+#include "Cubemap.h"
+#include "SphericalFunction.h"
+
+// implementation of SphericalFunction which uses cubemap texture look-up
+class SphericalFunctionCubemap : public SphericalFunction<sf::Vector3f> {
+    Cubemap& cubemap;
+public:
+    SphericalFunctionCubemap(Cubemap& cubemap) :
+        cubemap(cubemap)
+    {
+    }
+    sf::Vector3f getValue(const sf::Vector3f& v) {
+        return cubemap.getColorFromTexCoords(v);
+    }
+};
+
+// integrals of cubemap "function" multiplied by each basis function, BASIS_FUNCTION_COUNT colors
+// each integral is split between threadCount threads, with the same result for any thread count
+void calculateCubemapCoefficients(Cubemap& cubemap, unsigned int thetaResolution, unsigned int phiResolution,
+    sf::Vector3f* cubemapSHCoeff, int threadCount = 1);
+void calculateCubemapCoefficients(Cubemap& cubemap, const SphericalQuadrature& quadrature,
+    sf::Vector3f* cubemapSHCoeff, int threadCount = 1);
+
+// adaptive version, all basis functions share one refinement driven by the norm of their combined error,
+// returns that error estimate
+float calculateCubemapCoefficientsAdaptive(Cubemap& cubemap, float tolerance, sf::Vector3f* cubemapSHCoeff);
+
+#endif
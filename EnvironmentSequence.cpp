@@ -0,0 +1,154 @@
+#include "EnvironmentSequence.h"
+#include "CubemapProjection.h"
+
+#include <cstdlib>
+
+// frames that could not be read travel as NULL cubemaps, so the projection stage still sees every index
+void* decodeEnvironmentFrames(void* input) {
+    EnvironmentSequence* sequence = (EnvironmentSequence*)input;
+
+    for (unsigned int index = 0; index < sequence->frameCount; index++) {
+        std::string directory;
+        EnvironmentSequence::formatDirectory(sequence->pattern, index, directory);
+
+        Cubemap* cubemap = new Cubemap();
+        if (!cubemap->loadFromDirectory(directory)) {
+            delete cubemap;
+            cubemap = NULL;
+        }
+
+        if (!sequence->decodedFrames.push(cubemap)) {
+            delete cubemap;
+            break;
+        }
+    }
+
+    sequence->decodedFrames.close();
+    return NULL;
+}
+
+void* projectEnvironmentFrames(void* input) {
+    EnvironmentSequence* sequence = (EnvironmentSequence*)input;
+    Cubemap* cubemap;
+    unsigned int index = 0;
+
+    while (sequence->decodedFrames.pop(cubemap, true)) {
+        EnvironmentFrame* frame = new EnvironmentFrame();
+        frame->index = index++;
+        frame->loaded = (cubemap != NULL);
+
+        if (cubemap != NULL) {
+            calculateCubemapCoefficients(*cubemap, sequence->quadrature, frame->coefficients, sequence->threadCount);
+            delete cubemap;
+        }
+
+        if (sequence->output != NULL) {
+            fprintf(sequence->output, "%u", frame->index);
+            for (int basis = 0; basis < BASIS_FUNCTION_COUNT; basis++) {
+                fprintf(sequence->output, " %g %g %g", frame->coefficients[basis].x, frame->coefficients[basis].y,
+                    frame->coefficients[basis].z);
+            }
+            fprintf(sequence->output, "\n");
+        }
+
+        if (!sequence->projectedFrames.push(frame)) {
+            delete frame;
+            break;
+        }
+    }
+
+  // stopped early, the decode thread may still be waiting to push
+    sequence->decodedFrames.close();
+    while (sequence->decodedFrames.pop(cubemap, false)) delete cubemap;
+
+    sequence->projectedFrames.close();
+    return NULL;
+}
+
+EnvironmentSequence::EnvironmentSequence(const std::string& pattern, unsigned int frameCount,
+    unsigned int thetaResolution, unsigned int phiResolution, unsigned int queueCapacity, int threadCount):
+    pattern(pattern),
+    frameCount(frameCount),
+    threadCount(threadCount),
+    quadrature(thetaResolution, phiResolution),
+    output(NULL),
+    decodedFrames(queueCapacity),
+    projectedFrames(queueCapacity),
+    running(false)
+{
+}
+
+EnvironmentSequence::~EnvironmentSequence() {
+    this->stop();
+}
+
+bool EnvironmentSequence::start(const std::string& outputPath) {
+    if (this->running) return true;
+
+    std::string directory;
+    if (!formatDirectory(this->pattern, 0, directory)) return false;
+
+    if (!outputPath.empty()) {
+        this->output = fopen(outputPath.c_str(), "w");
+        if (this->output == NULL) return false;
+    }
+
+    this->running = true;
+    pthread_create(&this->decodeThread, NULL, decodeEnvironmentFrames, (void*)this);
+    pthread_create(&this->projectionThread, NULL, projectEnvironmentFrames, (void*)this);
+
+    return true;
+}
+
+void EnvironmentSequence::stop() {
+    if (!this->running) return;
+
+    this->decodedFrames.close();
+    this->projectedFrames.close();
+
+    pthread_join(this->decodeThread, NULL);
+    pthread_join(this->projectionThread, NULL);
+
+    EnvironmentFrame* frame;
+    while (this->projectedFrames.pop(frame, false)) delete frame;
+
+    if (this->output != NULL) fclose(this->output);
+    this->output = NULL;
+
+    this->running = false;
+}
+
+bool EnvironmentSequence::next(EnvironmentFrame& frame, bool wait) {
+    if (!this->running) return false;
+
+    EnvironmentFrame* projected;
+    if (!this->projectedFrames.pop(projected, wait)) return false;
+
+    frame = *projected;
+    delete projected;
+
+    return true;
+}
+
+// expands the first %d or %0<width>d, anything else after a % is rejected
+bool EnvironmentSequence::formatDirectory(const std::string& pattern, unsigned int index, std::string& directory) {
+    size_t start = pattern.find('%');
+    if (start == std::string::npos) return false;
+
+    size_t end = start + 1;
+    bool padded = (end < pattern.size() && pattern[end] == '0');
+    while (end < pattern.size() && pattern[end] >= '0' && pattern[end] <= '9') end++;
+    if (end >= pattern.size() || pattern[end] != 'd') return false;
+    if (pattern.find('%', end) != std::string::npos) return false;
+
+    unsigned int width = atoi(pattern.substr(start + 1, end - start - 1).c_str());
+
+    char digits[16];
+    sprintf(digits, "%u", index);
+
+    std::string number = digits;
+    if (number.size() < width) number.insert(0, width - number.size(), padded ? '0' : ' ');
+
+    directory = pattern.substr(0, start) + number + pattern.substr(end + 1);
+    return true;
+}
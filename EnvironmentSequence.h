@@ -0,0 +1,144 @@
+#ifndef _ENVIRONMENTSEQUENCE_H_
+#define _ENVIRONMENTSEQUENCE_H_
+
+#include "Cubemap.h"
+#include "SphericalFunction.h"
+#include "SphericalHarmonics.h"
+
+#include <cstdio>
+#include <deque>
+#include <string>
+
+#include <pthread.h>
+#include <SFML/System/Vector3.hpp>
+
+// fixed-capacity queue between two threads, push waits while full and pop waits while empty
+// after close, push fails and pop drains what is left
+template <typename T>
+class BoundedQueue {
+    std::deque<T> items;
+    unsigned int capacity;
+    bool closed;
+
+    pthread_mutex_t mutex;
+    pthread_cond_t notFull;
+    pthread_cond_t notEmpty;
+
+    BoundedQueue(const BoundedQueue&);
+    BoundedQueue& operator=(const BoundedQueue&);
+
+public:
+    BoundedQueue(unsigned int capacity) :
+        capacity(capacity > 0 ? capacity : 1),
+        closed(false)
+    {
+        pthread_mutex_init(&this->mutex, NULL);
+        pthread_cond_init(&this->notFull, NULL);
+        pthread_cond_init(&this->notEmpty, NULL);
+    }
+
+    ~BoundedQueue() {
+        pthread_mutex_destroy(&this->mutex);
+        pthread_cond_destroy(&this->notFull);
+        pthread_cond_destroy(&this->notEmpty);
+    }
+
+    bool push(const T& item) {
+        pthread_mutex_lock(&this->mutex);
+        while (!this->closed && this->items.size() >= this->capacity)
+            pthread_cond_wait(&this->notFull, &this->mutex);
+
+        bool pushed = !this->closed;
+        if (pushed) {
+            this->items.push_back(item);
+            pthread_cond_signal(&this->notEmpty);
+        }
+        pthread_mutex_unlock(&this->mutex);
+
+        return pushed;
+    }
+
+  // false once the queue is closed and empty, or straight away when empty if wait is false
+    bool pop(T& item, bool wait) {
+        pthread_mutex_lock(&this->mutex);
+        while (wait && !this->closed && this->items.empty())
+            pthread_cond_wait(&this->notEmpty, &this->mutex);
+
+        bool popped = !this->items.empty();
+        if (popped) {
+            item = this->items.front();
+            this->items.pop_front();
+            pthread_cond_signal(&this->notFull);
+        }
+        pthread_mutex_unlock(&this->mutex);
+
+        return popped;
+    }
+
+    void close() {
+        pthread_mutex_lock(&this->mutex);
+        this->closed = true;
+        pthread_cond_broadcast(&this->notFull);
+        pthread_cond_broadcast(&this->notEmpty);
+        pthread_mutex_unlock(&this->mutex);
+    }
+};
+
+// lighting coefficients of one frame of a sequence, all zero if its cubemap could not be read
+struct EnvironmentFrame {
+    unsigned int index;
+    bool loaded;
+    sf::Vector3f coefficients[BASIS_FUNCTION_COUNT];
+};
+
+/*
+   projects a numbered sequence of cubemap directories (e.g. captured environment video) as a pipeline:
+    -a decode thread reads frame N + 2 (its six faces are decoded concurrently by Cubemap)
+    -a projection thread integrates frame N + 1, split over threadCount threads
+    -the caller shades with frame N
+   stages are connected by bounded queues, so a slow stage holds back the ones before it instead of
+   piling up decoded frames, and every frame arrives in order exactly once
+
+   the directory pattern holds one printf-style integer field, %d or %0<width>d, numbered from 0
+   if an output file is given, the projection thread writes one line per frame to it:
+   the frame index followed by BASIS_FUNCTION_COUNT x 3 coefficients (r, g, b of each basis function)
+*/
+class EnvironmentSequence {
+    std::string pattern;
+    unsigned int frameCount;
+    int threadCount;
+
+    SphericalQuadrature quadrature;
+    FILE* output;
+
+    BoundedQueue<Cubemap*> decodedFrames;
+    BoundedQueue<EnvironmentFrame*> projectedFrames;
+
+    pthread_t decodeThread;
+    pthread_t projectionThread;
+    bool running;
+
+    friend void* decodeEnvironmentFrames(void* input);
+    friend void* projectEnvironmentFrames(void* input);
+
+    EnvironmentSequence(const EnvironmentSequence&);
+    EnvironmentSequence& operator=(const EnvironmentSequence&);
+
+public:
+    EnvironmentSequence(const std::string& pattern, unsigned int frameCount,
+        unsigned int thetaResolution, unsigned int phiResolution, unsigned int queueCapacity, int threadCount);
+    ~EnvironmentSequence();
+
+  // returns false if the pattern has no integer field or the output file cannot be created
+    bool start(const std::string& outputPath);
+
+  // stops early, frames still queued are dropped
+    void stop();
+
+  // next projected frame, false if none is ready yet (or, when waiting, if the sequence has ended)
+    bool next(EnvironmentFrame& frame, bool wait);
+
+    static bool formatDirectory(const std::string& pattern, unsigned int index, std::string& directory);
+};
+
+#endif
@@ -0,0 +1,257 @@
+#include "GlossyTransfer.h"
+
+#include <cfloat>
+#include <cmath>
+
+#include <pthread.h>
+
+// band of each basis function, for the zonal lobe coefficients
+static const int basisBand[BASIS_FUNCTION_COUNT] = { 0, 1, 1, 1, 2, 2, 2, 2, 2 };
+
+struct CalculateGlossyTransferParameters {
+    const float* normalPointer;
+    float* matrices;
+    unsigned int vertexCount;
+    unsigned int startBlock;
+    unsigned int endBlock;
+    unsigned int thetaResolution;
+    unsigned int phiResolution;
+};
+
+// basis values of all samples are evaluated once per thread, every entry is then a dense masked sum
+void* calculateGlossyTransferThreaded(void* input) {
+    CalculateGlossyTransferParameters* parameters = (CalculateGlossyTransferParameters*)input;
+    const unsigned int blockSize = GlossyTransfer::BLOCK_SIZE;
+
+    SphericalQuadrature quadrature(parameters->thetaResolution, parameters->phiResolution);
+    unsigned int sampleCount = quadrature.thetaResolution * quadrature.phiResolution;
+    if (sampleCount == 0) return NULL;
+
+    std::vector<float> x(sampleCount), y(sampleCount), z(sampleCount);
+    std::vector<float> basisValues(BASIS_FUNCTION_COUNT * sampleCount);
+    std::vector<float> maskedRow(sampleCount);
+
+    for (unsigned int thetaIter = 0; thetaIter < quadrature.thetaResolution; thetaIter++) {
+        for (unsigned int phiIter = 0; phiIter < quadrature.phiResolution; phiIter++) {
+            unsigned int sample = quadrature.phiResolution * thetaIter + phiIter;
+            x[sample] = quadrature.sinTheta[thetaIter] * quadrature.sinPhi[phiIter];
+            y[sample] = quadrature.cosTheta[thetaIter];
+            z[sample] = quadrature.sinTheta[thetaIter] * quadrature.cosPhi[phiIter];
+        }
+    }
+
+    calculateHarmonicBasisBlock(sampleCount, &x[0], &y[0], &z[0], &basisValues[0], sampleCount);
+
+  // same normalization as SphericalFunction::integrate, for biased theta
+    float average = 1.f / (float)sampleCount;
+    float domain = 4.f * M_PI;
+
+    for (unsigned int block = parameters->startBlock; block < parameters->endBlock; block++) {
+        float* blockMatrices = &parameters->matrices[GLOSSY_MATRIX_ENTRY_COUNT * blockSize * block];
+
+        for (unsigned int lane = 0; lane < blockSize; lane++) {
+            unsigned int vertex = blockSize * block + lane;
+            if (vertex >= parameters->vertexCount) break;
+
+            float normalX = parameters->normalPointer[3 * vertex + 0];
+            float normalY = parameters->normalPointer[3 * vertex + 1];
+            float normalZ = parameters->normalPointer[3 * vertex + 2];
+
+            int entry = 0;
+            for (int row = 0; row < BASIS_FUNCTION_COUNT; row++) {
+                const float* rowValues = &basisValues[row * sampleCount];
+
+              // hemisphere(s) * Y_row(s), shared by the rest of the row
+                for (unsigned int sample = 0; sample < sampleCount; sample++) {
+                    bool visible = normalX * x[sample] + normalY * y[sample] + normalZ * z[sample] > 0.f;
+                    maskedRow[sample] = visible ? rowValues[sample] : 0.f;
+                }
+
+                for (int column = row; column < BASIS_FUNCTION_COUNT; column++) {
+                    const float* columnValues = &basisValues[column * sampleCount];
+                    float integral = 0.f;
+
+                    for (unsigned int sample = 0; sample < sampleCount; sample++)
+                        integral += maskedRow[sample] * columnValues[sample];
+
+                    integral *= average;
+                    integral *= domain;
+                    blockMatrices[blockSize * entry + lane] = integral;
+                    entry++;
+                }
+            }
+        }
+    }
+
+    return NULL;
+}
+
+const unsigned int GlossyTransfer::BLOCK_SIZE;
+
+GlossyTransfer::GlossyTransfer(float shininess):
+    vertexCount(0),
+    blockCount(0),
+    shininess(shininess)
+{
+}
+
+void GlossyTransfer::bake(const float* normalPointer, unsigned int vertexCount,
+    unsigned int thetaResolution, unsigned int phiResolution, int threadCount)
+{
+    this->vertexCount = vertexCount;
+    this->blockCount = (vertexCount + BLOCK_SIZE - 1) / BLOCK_SIZE;
+
+  // lanes past the last vertex stay zero and shade to black
+    this->matrices.assign(GLOSSY_MATRIX_ENTRY_COUNT * BLOCK_SIZE * this->blockCount, 0.f);
+    if (this->blockCount == 0) return;
+
+    if (threadCount < 1) threadCount = 1;
+
+    std::vector<pthread_t> threadArray(threadCount);
+    std::vector<CalculateGlossyTransferParameters> inputArray(threadCount);
+
+  // threads get whole blocks, so no two threads write to the same block
+    for (int threadIndex = 0; threadIndex < threadCount; threadIndex++) {
+        CalculateGlossyTransferParameters* input = &inputArray[threadIndex];
+
+        input->normalPointer = normalPointer;
+        input->matrices = &this->matrices[0];
+        input->vertexCount = vertexCount;
+        input->startBlock = (threadIndex + 0) * this->blockCount / threadCount;
+        input->endBlock = (threadIndex + 1) * this->blockCount / threadCount;
+        input->thetaResolution = thetaResolution;
+        input->phiResolution = phiResolution;
+
+        pthread_create(&threadArray[threadIndex], NULL, calculateGlossyTransferThreaded, (void*)input);
+    }
+
+    for (int threadIndex = 0; threadIndex < threadCount; threadIndex++) {
+        pthread_join(threadArray[threadIndex], NULL);
+    }
+}
+
+/*
+   the normalized Phong lobe (n + 1) / 2pi * cos^n about the reflection direction r has zonal coefficients
+   that scale band l of a function convolved with it by 1, (n + 1) / (n + 2) and n / (n + 3), so
+     exit radiance = sum over i of lobe_l(i) * Y_i(r) * (M * L)_i
+   prepared lighting coefficients are radiance divided by pi (see prepareShadingCoefficients), so pi is put back
+
+   every loop over lanes has the fixed length BLOCK_SIZE and no dependencies between lanes, so with the
+   Makefile's -O2 (and SIMDFLAGS for wider registers) the per-block work becomes vector instructions
+*/
+void GlossyTransfer::shade(const sf::Vector3f* shadingSHCoeff, const float* vertexPointer,
+    const float* normalPointer, const sf::Vector3f& eyePosition, float* modelColors) const
+{
+    float lobe[3];
+    lobe[0] = M_PI;
+    lobe[1] = M_PI * (this->shininess + 1.f) / (this->shininess + 2.f);
+    lobe[2] = M_PI * this->shininess / (this->shininess + 3.f);
+
+    float lighting[3][BASIS_FUNCTION_COUNT];
+    for (int basis = 0; basis < BASIS_FUNCTION_COUNT; basis++) {
+        lighting[0][basis] = shadingSHCoeff[basis].x;
+        lighting[1][basis] = shadingSHCoeff[basis].y;
+        lighting[2][basis] = shadingSHCoeff[basis].z;
+    }
+
+    for (unsigned int block = 0; block < this->blockCount; block++) {
+        const float* blockMatrices = &this->matrices[GLOSSY_MATRIX_ENTRY_COUNT * BLOCK_SIZE * block];
+        unsigned int laneCount = this->vertexCount - BLOCK_SIZE * block;
+        if (laneCount > BLOCK_SIZE) laneCount = BLOCK_SIZE;
+
+      // reflected view directions, lanes past the last vertex get a zero direction (their matrices are zero)
+        float normal[3][BLOCK_SIZE], view[3][BLOCK_SIZE];
+
+        for (unsigned int lane = 0; lane < BLOCK_SIZE; lane++) {
+            unsigned int vertex = BLOCK_SIZE * block + lane;
+            bool active = lane < laneCount;
+
+            for (int axis = 0; axis < 3; axis++) {
+                normal[axis][lane] = active ? normalPointer[3 * vertex + axis] : 0.f;
+                view[axis][lane] = active ? (&eyePosition.x)[axis] - vertexPointer[3 * vertex + axis] : 0.f;
+            }
+        }
+
+        float reflection[3][BLOCK_SIZE];
+        for (unsigned int lane = 0; lane < BLOCK_SIZE; lane++) {
+            float viewLengthSquared = view[0][lane] * view[0][lane] + view[1][lane] * view[1][lane] +
+                view[2][lane] * view[2][lane];
+
+          // FLT_MIN only matters for a zero view vector, which then reflects to zero instead of NaN
+            float inverseLength = 1.f / sqrtf(viewLengthSquared + FLT_MIN);
+
+            float normalDotView = (normal[0][lane] * view[0][lane] + normal[1][lane] * view[1][lane] +
+                normal[2][lane] * view[2][lane]) * inverseLength;
+
+            reflection[0][lane] = 2.f * normalDotView * normal[0][lane] - view[0][lane] * inverseLength;
+            reflection[1][lane] = 2.f * normalDotView * normal[1][lane] - view[1][lane] * inverseLength;
+            reflection[2][lane] = 2.f * normalDotView * normal[2][lane] - view[2][lane] * inverseLength;
+        }
+
+      // lobe around the reflected view direction, all basis functions of the block in one call
+        float kernel[BASIS_FUNCTION_COUNT][BLOCK_SIZE];
+        calculateHarmonicBasisBlock(BLOCK_SIZE, reflection[0], reflection[1], reflection[2], &kernel[0][0], BLOCK_SIZE);
+
+        for (int basis = 0; basis < BASIS_FUNCTION_COUNT; basis++) {
+            float lobeFactor = lobe[basisBand[basis]];
+            for (unsigned int lane = 0; lane < BLOCK_SIZE; lane++) kernel[basis][lane] *= lobeFactor;
+        }
+
+      // transferred radiance M * L for each channel, walking the upper triangle once
+        float transferred[3][BASIS_FUNCTION_COUNT][BLOCK_SIZE];
+        for (int channel = 0; channel < 3; channel++) {
+            for (int basis = 0; basis < BASIS_FUNCTION_COUNT; basis++) {
+                for (unsigned int lane = 0; lane < BLOCK_SIZE; lane++) transferred[channel][basis][lane] = 0.f;
+            }
+        }
+
+        const float* entryValues = blockMatrices;
+        for (int row = 0; row < BASIS_FUNCTION_COUNT; row++) {
+            for (int column = row; column < BASIS_FUNCTION_COUNT; column++) {
+                for (int channel = 0; channel < 3; channel++) {
+                    float rowLighting = lighting[channel][row];
+                    float columnLighting = lighting[channel][column];
+
+                    for (unsigned int lane = 0; lane < BLOCK_SIZE; lane++)
+                        transferred[channel][row][lane] += entryValues[lane] * columnLighting;
+
+                    if (column != row) {
+                        for (unsigned int lane = 0; lane < BLOCK_SIZE; lane++)
+                            transferred[channel][column][lane] += entryValues[lane] * rowLighting;
+                    }
+                }
+
+                entryValues += BLOCK_SIZE;
+            }
+        }
+
+        float colors[3][BLOCK_SIZE];
+        for (int channel = 0; channel < 3; channel++) {
+            for (unsigned int lane = 0; lane < BLOCK_SIZE; lane++) colors[channel][lane] = 0.f;
+
+            for (int basis = 0; basis < BASIS_FUNCTION_COUNT; basis++) {
+                for (unsigned int lane = 0; lane < BLOCK_SIZE; lane++)
+                    colors[channel][lane] += kernel[basis][lane] * transferred[channel][basis][lane];
+            }
+        }
+
+        for (unsigned int lane = 0; lane < laneCount; lane++) {
+            unsigned int vertex = BLOCK_SIZE * block + lane;
+            modelColors[3 * vertex + 0] = colors[0][lane];
+            modelColors[3 * vertex + 1] = colors[1][lane];
+            modelColors[3 * vertex + 2] = colors[2][lane];
+        }
+    }
+}
+
+float GlossyTransfer::getShininess() const {
+    return this->shininess;
+}
+
+unsigned int GlossyTransfer::getVertexCount() const {
+    return this->vertexCount;
+}
+
+size_t GlossyTransfer::getByteCount() const {
+    return this->matrices.size() * sizeof(float);
+}
@@ -0,0 +1,50 @@
+#ifndef _GLOSSYTRANSFER_H_
+#define _GLOSSYTRANSFER_H_
+
+#include "SphericalFunction.h"
+#include "SphericalHarmonics.h"
+
+#include <cstddef>
+#include <vector>
+
+#include <SFML/System/Vector3.hpp>
+
+// upper triangle of a symmetric BASIS_FUNCTION_COUNT x BASIS_FUNCTION_COUNT matrix, row by row
+#define GLOSSY_MATRIX_ENTRY_COUNT (BASIS_FUNCTION_COUNT * (BASIS_FUNCTION_COUNT + 1) / 2)
+
+/*
+   view-dependent transfer for a normalized Phong lobe, per vertex:
+    -a transfer matrix M_ij = integral of hemisphere(s) * Y_i(s) * Y_j(s), turning lighting into the
+     radiance arriving over the vertex's hemisphere (still as coefficients)
+    -the lobe around the reflected view direction, as zonal harmonics, turning that into exit radiance
+   the matrices are symmetric, so only GLOSSY_MATRIX_ENTRY_COUNT entries are kept
+
+   vertices are stored in blocks of BLOCK_SIZE, entry by entry (the block holds entry 0 of every vertex,
+   then entry 1, ...), so shading walks each block once, front to back, with every step across all lanes
+*/
+class GlossyTransfer {
+    unsigned int vertexCount;
+    unsigned int blockCount;
+    float shininess;
+
+    std::vector<float> matrices;
+
+public:
+    static const unsigned int BLOCK_SIZE = 8;
+
+    GlossyTransfer(float shininess);
+
+  // integrates the matrices with the existing quadrature, blocks divided evenly between threads
+    void bake(const float* normalPointer, unsigned int vertexCount,
+        unsigned int thetaResolution, unsigned int phiResolution, int threadCount);
+
+  // exit radiance towards the eye (in model space) for prepared lighting coefficients, 3 floats per vertex
+    void shade(const sf::Vector3f* shadingSHCoeff, const float* vertexPointer, const float* normalPointer,
+        const sf::Vector3f& eyePosition, float* modelColors) const;
+
+    float getShininess() const;
+    unsigned int getVertexCount() const;
+    size_t getByteCount() const;
+};
+
+#endif
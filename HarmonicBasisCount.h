@@ -0,0 +1,8 @@
+#ifndef _HARMONICBASISCOUNT_H_
+#define _HARMONICBASISCOUNT_H_
+
+// number of spherical harmonic basis functions (bands 0 to 2), kept apart from SphericalHarmonics.h
+// so headers that only size arrays by it do not pull in the basis functions and SFML
+#define BASIS_FUNCTION_COUNT 9
+
+#endif
@@ -0,0 +1,190 @@
+#include "IrradianceCubemap.h"
+
+#include <cmath>
+#include <vector>
+
+#include <pthread.h>
+
+// convolution of each band with the clamped cosine lobe, so basis values turn into irradiance
+static const float cosineLobe[BASIS_FUNCTION_COUNT] = {
+    M_PI,
+    2.f * M_PI / 3.f, 2.f * M_PI / 3.f, 2.f * M_PI / 3.f,
+    M_PI / 4.f, M_PI / 4.f, M_PI / 4.f, M_PI / 4.f, M_PI / 4.f
+};
+
+// rows of all faces are numbered face by face, so threads can be given ranges of rows
+struct BakeIrradianceParameters {
+    IrradianceCubemap* cubemap;
+    const sf::Vector3f* shadingSHCoeff;
+    unsigned int startRow;
+    unsigned int endRow;
+};
+
+void* bakeIrradianceThreaded(void* input) {
+    BakeIrradianceParameters* parameters = (BakeIrradianceParameters*)input;
+    IrradianceCubemap* cubemap = parameters->cubemap;
+    unsigned int resolution = cubemap->resolution;
+
+    for (unsigned int row = parameters->startRow; row < parameters->endRow; row++) {
+        Cubemap::Face face = (Cubemap::Face)(row / resolution);
+
+        for (unsigned int column = 0; column < resolution; column++) {
+            unsigned int texel = resolution * row + column;
+            float* basisValues = &cubemap->basisValues[BASIS_FUNCTION_COUNT * texel];
+
+            sf::Vector2f faceTexCoords((column + 0.5f) / resolution, (row % resolution + 0.5f) / resolution);
+            sf::Vector3f direction = Cubemap::getTexCoordsFromFace(face, faceTexCoords);
+            direction /= (float)sqrt(direction.x * direction.x + direction.y * direction.y + direction.z * direction.z);
+
+            sf::Vector3f color(0.f, 0.f, 0.f);
+            for (int basis = 0; basis < BASIS_FUNCTION_COUNT; basis++) {
+                basisValues[basis] = cosineLobe[basis] * SphericalHarmonics[basis].getValue(direction);
+                color += parameters->shadingSHCoeff[basis] * basisValues[basis];
+            }
+
+            cubemap->texels[3 * texel + 0] = color.x;
+            cubemap->texels[3 * texel + 1] = color.y;
+            cubemap->texels[3 * texel + 2] = color.z;
+        }
+    }
+
+    return NULL;
+}
+
+IrradianceCubemap::IrradianceCubemap(unsigned int resolution, int threadCount):
+    resolution(resolution > 0 ? resolution : 1),
+    threadCount(threadCount > 0 ? threadCount : 1),
+    baked(false),
+    refreshCount(0)
+{
+    unsigned int texelCount = 6 * this->resolution * this->resolution;
+    this->texels = new float[3 * texelCount];
+    this->basisValues = new float[BASIS_FUNCTION_COUNT * texelCount];
+}
+
+IrradianceCubemap::~IrradianceCubemap() {
+    delete[] this->texels;
+    delete[] this->basisValues;
+}
+
+void IrradianceCubemap::bake(const sf::Vector3f* shadingSHCoeff) {
+    std::vector<pthread_t> threadArray(this->threadCount);
+    std::vector<BakeIrradianceParameters> inputArray(this->threadCount);
+
+    unsigned int totalRows = 6 * this->resolution;
+
+    for (int threadIndex = 0; threadIndex < this->threadCount; threadIndex++) {
+        BakeIrradianceParameters* input = &inputArray[threadIndex];
+
+        input->cubemap = this;
+        input->shadingSHCoeff = shadingSHCoeff;
+        input->startRow = (threadIndex + 0) * totalRows / this->threadCount;
+        input->endRow = (threadIndex + 1) * totalRows / this->threadCount;
+
+        pthread_create(&threadArray[threadIndex], NULL, bakeIrradianceThreaded, (void*)input);
+    }
+
+    for (int threadIndex = 0; threadIndex < this->threadCount; threadIndex++) {
+        pthread_join(threadArray[threadIndex], NULL);
+    }
+
+    for (int basis = 0; basis < BASIS_FUNCTION_COUNT; basis++) this->bakedSHCoeff[basis] = shadingSHCoeff[basis];
+    this->baked = true;
+    this->refreshCount = 0;
+}
+
+void IrradianceCubemap::refresh(const sf::Vector3f* shadingSHCoeff) {
+    if (!this->baked || this->refreshCount >= 256) {
+        this->bake(shadingSHCoeff);
+        return;
+    }
+
+    unsigned int texelCount = 6 * this->resolution * this->resolution;
+    bool changed = false;
+
+    for (int basis = 0; basis < BASIS_FUNCTION_COUNT; basis++) {
+        if (shadingSHCoeff[basis] == this->bakedSHCoeff[basis]) continue;
+        changed = true;
+
+        sf::Vector3f difference = shadingSHCoeff[basis] - this->bakedSHCoeff[basis];
+
+        for (unsigned int texel = 0; texel < texelCount; texel++) {
+            float value = this->basisValues[BASIS_FUNCTION_COUNT * texel + basis];
+            this->texels[3 * texel + 0] += difference.x * value;
+            this->texels[3 * texel + 1] += difference.y * value;
+            this->texels[3 * texel + 2] += difference.z * value;
+        }
+
+        this->bakedSHCoeff[basis] = shadingSHCoeff[basis];
+    }
+
+  // unchanged lighting adds no rounding error, so only real updates count towards the next full bake
+    if (changed) this->refreshCount++;
+}
+
+sf::Vector3f IrradianceCubemap::getColorFromTexCoords(const sf::Vector3f& texCoords) const {
+    sf::Vector2f faceTexCoords;
+    Cubemap::Face face = Cubemap::getFaceFromTexCoords(texCoords, faceTexCoords);
+
+  // texel centers sit at (i + 0.5) / resolution
+    float imageX = faceTexCoords.x * this->resolution - 0.5f;
+    float imageY = faceTexCoords.y * this->resolution - 0.5f;
+
+    int maximum = this->resolution - 1;
+    if (imageX < 0.f) imageX = 0.f;
+    if (imageY < 0.f) imageY = 0.f;
+    if (imageX > maximum) imageX = maximum;
+    if (imageY > maximum) imageY = maximum;
+
+    int column0 = (int)imageX;
+    int row0 = (int)imageY;
+    int column1 = (column0 < maximum) ? column0 + 1 : column0;
+    int row1 = (row0 < maximum) ? row0 + 1 : row0;
+
+    float blendX = imageX - column0;
+    float blendY = imageY - row0;
+
+    const float* faceTexels = &this->texels[3 * this->resolution * this->resolution * face];
+    const float* texel00 = &faceTexels[3 * (this->resolution * row0 + column0)];
+    const float* texel01 = &faceTexels[3 * (this->resolution * row0 + column1)];
+    const float* texel10 = &faceTexels[3 * (this->resolution * row1 + column0)];
+    const float* texel11 = &faceTexels[3 * (this->resolution * row1 + column1)];
+
+    float weight00 = (1.f - blendX) * (1.f - blendY);
+    float weight01 = blendX * (1.f - blendY);
+    float weight10 = (1.f - blendX) * blendY;
+    float weight11 = blendX * blendY;
+
+    sf::Vector3f color;
+    color.x = weight00 * texel00[0] + weight01 * texel01[0] + weight10 * texel10[0] + weight11 * texel11[0];
+    color.y = weight00 * texel00[1] + weight01 * texel01[1] + weight10 * texel10[1] + weight11 * texel11[1];
+    color.z = weight00 * texel00[2] + weight01 * texel01[2] + weight10 * texel10[2] + weight11 * texel11[2];
+
+    return color;
+}
+
+void IrradianceCubemap::calculateModelColors(unsigned int vertexCount, const float* normalPointer,
+    float* modelColors, float angle) const
+{
+  // float copies for the same Vector3 template matching reason as in prepareShadingCoefficients
+    float cosAngle = cos(angle);
+    float sinAngle = sin(angle);
+
+    for (unsigned int iter = 0; iter < vertexCount; iter++) {
+        float x = normalPointer[3 * iter + 0];
+        float y = normalPointer[3 * iter + 1];
+        float z = normalPointer[3 * iter + 2];
+
+      // prepareShadingCoefficients turns the lighting about the z axis
+        sf::Vector3f normal(cosAngle * x + sinAngle * y, -sinAngle * x + cosAngle * y, z);
+        sf::Vector3f color = this->getColorFromTexCoords(normal);
+
+        modelColors[3 * iter + 0] = color.x;
+        modelColors[3 * iter + 1] = color.y;
+        modelColors[3 * iter + 2] = color.z;
+    }
+}
+
+unsigned int IrradianceCubemap::getResolution() const {
+    return this->resolution;
+}
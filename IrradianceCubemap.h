@@ -0,0 +1,51 @@
+#ifndef _IRRADIANCECUBEMAP_H_
+#define _IRRADIANCECUBEMAP_H_
+
+#include "Cubemap.h"
+#include "SphericalHarmonics.h"
+
+#include <SFML/System/Vector3.hpp>
+
+/*
+   small float cubemap holding the irradiance of prepared (rotated and normalized) lighting coefficients,
+   using the same face layout and addressing as Cubemap, so any direction costs one filtered look-up
+   the convolved basis values of every texel are kept, which lets refresh() apply only changed coefficients
+*/
+class IrradianceCubemap {
+    unsigned int resolution;
+    int threadCount;
+
+    float* texels;
+    float* basisValues;
+
+    sf::Vector3f bakedSHCoeff[BASIS_FUNCTION_COUNT];
+    bool baked;
+    unsigned int refreshCount;
+
+    IrradianceCubemap(const IrradianceCubemap&);
+    IrradianceCubemap& operator=(const IrradianceCubemap&);
+
+    friend void* bakeIrradianceThreaded(void* input);
+
+public:
+    IrradianceCubemap(unsigned int resolution, int threadCount);
+    ~IrradianceCubemap();
+
+  // evaluates every texel from scratch, divided between threads
+    void bake(const sf::Vector3f* shadingSHCoeff);
+
+  // adds the difference of changed coefficients only, with a full bake every so many changes to limit drift
+    void refresh(const sf::Vector3f* shadingSHCoeff);
+
+  // bilinear look-up within the face, clamped at face edges
+    sf::Vector3f getColorFromTexCoords(const sf::Vector3f& texCoords) const;
+
+  // 3 floats of color per normal, for the baked lighting turned by angle as in prepareShadingCoefficients,
+  // which is the same as looking up the normal turned back by angle, so rotating lighting needs no new bake
+    void calculateModelColors(unsigned int vertexCount, const float* normalPointer, float* modelColors,
+        float angle = 0.f) const;
+
+    unsigned int getResolution() const;
+};
+
+#endif
@@ -0,0 +1,240 @@
+#include "LightProbeGrid.h"
+#include "Cubemap.h"
+#include "CubemapProjection.h"
+#include "Shading.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <utility>
+
+#include <pthread.h>
+
+// 10 bits per axis keeps a Morton code within 30 bits
+static const unsigned int MAXIMUM_DIMENSION = 1024;
+
+// moves bit i of the value to bit 3i
+static unsigned int spreadBits(unsigned int value) {
+    unsigned int spread = 0;
+    for (int bit = 0; bit < 10; bit++) spread |= ((value >> bit) & 1) << (3 * bit);
+    return spread;
+}
+
+struct ProjectProbeParameters {
+    Cubemap* cubemap;
+    const SphericalQuadrature* quadrature;
+    sf::Vector3f* probeSHCoeff;
+};
+
+void* projectProbeThreaded(void* input) {
+    ProjectProbeParameters* parameters = (ProjectProbeParameters*)input;
+    calculateCubemapCoefficients(*parameters->cubemap, *parameters->quadrature, parameters->probeSHCoeff);
+    return NULL;
+}
+
+const unsigned int LightProbeGrid::PROBE_STRIDE;
+
+LightProbeGrid::LightProbeGrid():
+    slotCount(0)
+{
+    this->dimensions[0] = this->dimensions[1] = this->dimensions[2] = 0;
+}
+
+void LightProbeGrid::setDimensions(unsigned int nx, unsigned int ny, unsigned int nz) {
+    this->dimensions[0] = nx;
+    this->dimensions[1] = ny;
+    this->dimensions[2] = nz;
+
+  // probes sorted by Morton code, a probe's slot is its position in that order
+    this->slotCount = nx * ny * nz;
+    std::vector<std::pair<unsigned int, unsigned int> > codes(this->slotCount);
+
+    for (unsigned int z = 0; z < nz; z++) {
+        for (unsigned int y = 0; y < ny; y++) {
+            for (unsigned int x = 0; x < nx; x++) {
+                unsigned int probe = x + nx * (y + ny * z);
+                codes[probe] = std::make_pair(spreadBits(x) | (spreadBits(y) << 1) | (spreadBits(z) << 2), probe);
+            }
+        }
+    }
+
+    std::sort(codes.begin(), codes.end());
+
+    this->slots.resize(this->slotCount);
+    for (unsigned int slot = 0; slot < this->slotCount; slot++) this->slots[codes[slot].second] = slot;
+
+    this->probeSHCoeff.assign(BASIS_FUNCTION_COUNT * this->slotCount, sf::Vector3f(0.f, 0.f, 0.f));
+    this->shadingSHCoeff.assign(PROBE_STRIDE * this->slotCount, 0.f);
+}
+
+unsigned int LightProbeGrid::getSlot(unsigned int x, unsigned int y, unsigned int z) const {
+    return this->slots[x + this->dimensions[0] * (y + this->dimensions[1] * z)];
+}
+
+bool LightProbeGrid::loadFromFile(const std::string& filePath, unsigned int thetaResolution,
+    unsigned int phiResolution, int threadCount)
+{
+    std::ifstream file(filePath.c_str());
+    if (!file) return false;
+
+    unsigned int nx = 0, ny = 0, nz = 0;
+    file >> nx >> ny >> nz;
+    file >> this->minimum.x >> this->minimum.y >> this->minimum.z;
+    file >> this->maximum.x >> this->maximum.y >> this->maximum.z;
+
+    if (!file || nx == 0 || ny == 0 || nz == 0) return false;
+    if (nx > MAXIMUM_DIMENSION || ny > MAXIMUM_DIMENSION || nz > MAXIMUM_DIMENSION) return false;
+
+    std::string baseDirectory;
+    size_t separator = filePath.find_last_of("/\\");
+    if (separator != std::string::npos) baseDirectory = filePath.substr(0, separator + 1);
+
+    unsigned int probeCount = nx * ny * nz;
+    std::vector<std::string> directories(probeCount);
+
+    for (unsigned int probe = 0; probe < probeCount; probe++) {
+        if (!(file >> directories[probe])) return false;
+
+        bool absolute = directories[probe][0] == '/' || directories[probe][0] == '\\' ||
+            directories[probe].find(':') != std::string::npos;
+        if (!absolute) directories[probe] = baseDirectory + directories[probe];
+    }
+
+    this->setDimensions(nx, ny, nz);
+
+    if (threadCount < 1) threadCount = 1;
+    SphericalQuadrature quadrature(thetaResolution, phiResolution);
+
+    std::vector<pthread_t> threadArray(threadCount);
+    std::vector<ProjectProbeParameters> inputArray(threadCount);
+    std::vector<Cubemap*> cubemaps(threadCount);
+
+  // cubemaps are decoded one at a time (their faces in parallel), only threadCount are held at once
+    for (unsigned int batchStart = 0; batchStart < probeCount; batchStart += threadCount) {
+        unsigned int batchSize = probeCount - batchStart;
+        if (batchSize > (unsigned int)threadCount) batchSize = threadCount;
+
+        for (unsigned int threadIndex = 0; threadIndex < batchSize; threadIndex++) {
+            unsigned int probe = batchStart + threadIndex;
+            unsigned int x = probe % nx;
+            unsigned int y = (probe / nx) % ny;
+            unsigned int z = probe / (nx * ny);
+
+            cubemaps[threadIndex] = new Cubemap();
+            if (!cubemaps[threadIndex]->loadFromDirectory(directories[probe])) {
+                std::cout << "could not read light probe " << directories[probe] << std::endl;
+
+                for (unsigned int loaded = 0; loaded <= threadIndex; loaded++) delete cubemaps[loaded];
+                return false;
+            }
+
+            ProjectProbeParameters* input = &inputArray[threadIndex];
+            input->cubemap = cubemaps[threadIndex];
+            input->quadrature = &quadrature;
+            input->probeSHCoeff = &this->probeSHCoeff[BASIS_FUNCTION_COUNT * this->getSlot(x, y, z)];
+        }
+
+        for (unsigned int threadIndex = 0; threadIndex < batchSize; threadIndex++)
+            pthread_create(&threadArray[threadIndex], NULL, projectProbeThreaded, (void*)&inputArray[threadIndex]);
+
+        for (unsigned int threadIndex = 0; threadIndex < batchSize; threadIndex++) {
+            pthread_join(threadArray[threadIndex], NULL);
+            delete cubemaps[threadIndex];
+        }
+
+        std::cout << "projected " << batchStart + batchSize << " of " << probeCount << " probes" << std::endl;
+    }
+
+    this->prepare(0.f);
+    return true;
+}
+
+void LightProbeGrid::prepare(float angle) {
+    sf::Vector3f prepared[BASIS_FUNCTION_COUNT];
+
+    for (unsigned int slot = 0; slot < this->slotCount; slot++) {
+        prepareShadingCoefficients(angle, &this->probeSHCoeff[BASIS_FUNCTION_COUNT * slot], prepared);
+
+        float* probe = &this->shadingSHCoeff[PROBE_STRIDE * slot];
+        for (int basis = 0; basis < BASIS_FUNCTION_COUNT; basis++) {
+            probe[0 * BASIS_FUNCTION_COUNT + basis] = prepared[basis].x;
+            probe[1 * BASIS_FUNCTION_COUNT + basis] = prepared[basis].y;
+            probe[2 * BASIS_FUNCTION_COUNT + basis] = prepared[basis].z;
+        }
+    }
+}
+
+/*
+   probes are blended over the whole padded stride at once, a fixed-length loop that vectorizes at -O2,
+   then the blended probe is used exactly like the global coefficients in calculateModelColors
+*/
+void LightProbeGrid::calculateModelColors(unsigned int vertexCount, const float* vertexPointer,
+    const float* normalSHCoeff, float* modelColors) const
+{
+    if (this->slotCount == 0) return;
+
+    const float minimum[3] = { this->minimum.x, this->minimum.y, this->minimum.z };
+    const float maximum[3] = { this->maximum.x, this->maximum.y, this->maximum.z };
+
+    float scale[3];
+    for (int axis = 0; axis < 3; axis++) {
+        float extent = maximum[axis] - minimum[axis];
+        scale[axis] = (extent > 0.f) ? (this->dimensions[axis] - 1) / extent : 0.f;
+    }
+
+    for (unsigned int iter = 0; iter < vertexCount; iter++) {
+        unsigned int cell0[3], cell1[3];
+        float blend[3];
+
+        for (int axis = 0; axis < 3; axis++) {
+            unsigned int last = this->dimensions[axis] - 1;
+
+            float position = (vertexPointer[3 * iter + axis] - minimum[axis]) * scale[axis];
+            if (position < 0.f) position = 0.f;
+            if (position > last) position = last;
+
+          // the upper cell is used for positions on the far face, so blend can reach 1
+            cell0[axis] = (unsigned int)position;
+            if (cell0[axis] == last && last > 0) cell0[axis]--;
+            cell1[axis] = (last > 0) ? cell0[axis] + 1 : cell0[axis];
+            blend[axis] = position - cell0[axis];
+        }
+
+        const float* corners[8];
+        float weights[8];
+
+        for (int corner = 0; corner < 8; corner++) {
+            unsigned int x = (corner & 1) ? cell1[0] : cell0[0];
+            unsigned int y = (corner & 2) ? cell1[1] : cell0[1];
+            unsigned int z = (corner & 4) ? cell1[2] : cell0[2];
+
+            corners[corner] = &this->shadingSHCoeff[PROBE_STRIDE * this->getSlot(x, y, z)];
+            weights[corner] = ((corner & 1) ? blend[0] : 1.f - blend[0]) *
+                ((corner & 2) ? blend[1] : 1.f - blend[1]) *
+                ((corner & 4) ? blend[2] : 1.f - blend[2]);
+        }
+
+        float blended[PROBE_STRIDE];
+        for (unsigned int value = 0; value < PROBE_STRIDE; value++) blended[value] = 0.f;
+
+        for (int corner = 0; corner < 8; corner++) {
+            const float* probe = corners[corner];
+            float weight = weights[corner];
+
+            for (unsigned int value = 0; value < PROBE_STRIDE; value++) blended[value] += weight * probe[value];
+        }
+
+        const float* transfer = &normalSHCoeff[BASIS_FUNCTION_COUNT * iter];
+        for (int channel = 0; channel < 3; channel++) {
+            float color = 0.f;
+            for (int basis = 0; basis < BASIS_FUNCTION_COUNT; basis++)
+                color += blended[BASIS_FUNCTION_COUNT * channel + basis] * transfer[basis];
+
+            modelColors[3 * iter + channel] = color;
+        }
+    }
+}
+
+unsigned int LightProbeGrid::getProbeCount() const {
+    return this->dimensions[0] * this->dimensions[1] * this->dimensions[2];
+}
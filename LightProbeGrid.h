@@ -0,0 +1,60 @@
+#ifndef _LIGHTPROBEGRID_H_
+#define _LIGHTPROBEGRID_H_
+
+#include "SphericalHarmonics.h"
+
+#include <string>
+#include <vector>
+
+#include <SFML/System/Vector3.hpp>
+
+/*
+   regular 3D grid of lighting coefficients for spatially varying lighting, each probe projected from its own cubemap
+   probes are stored in Morton (Z-order) so the 8 corners of a cell, and cells near each other, share cache lines
+   only the grid's own probes are stored, each at its rank among their Morton codes, so any shape packs densely
+
+   grids are described by a text file:
+    nx ny nz
+    minX minY minZ maxX maxY maxZ
+    followed by nx * ny * nz cubemap directories, x fastest, then y, then z
+   bounds are in model space, relative directories are relative to the file
+*/
+class LightProbeGrid {
+    unsigned int dimensions[3];
+    sf::Vector3f minimum;
+    sf::Vector3f maximum;
+
+  // slot of every probe, x fastest, then y, then z
+    std::vector<unsigned int> slots;
+    unsigned int slotCount;
+
+  // BASIS_FUNCTION_COUNT colors per slot, as projected
+    std::vector<sf::Vector3f> probeSHCoeff;
+
+  // prepared for the current rotation, channel by channel and padded to PROBE_STRIDE floats
+    std::vector<float> shadingSHCoeff;
+
+    void setDimensions(unsigned int nx, unsigned int ny, unsigned int nz);
+    unsigned int getSlot(unsigned int x, unsigned int y, unsigned int z) const;
+
+public:
+    static const unsigned int PROBE_STRIDE = 32;
+
+    LightProbeGrid();
+
+  // cubemaps are decoded one batch at a time and the batch is projected with a thread per probe
+  // returns false if the file is malformed or any probe's cubemap cannot be read
+    bool loadFromFile(const std::string& filePath, unsigned int thetaResolution, unsigned int phiResolution,
+        int threadCount);
+
+  // rotates and normalizes every probe once, ahead of any number of calculateModelColors calls
+    void prepare(float angle);
+
+  // trilinear blend of the 8 probes around each vertex (clamped to the grid), dotted with its normal coefficients
+    void calculateModelColors(unsigned int vertexCount, const float* vertexPointer, const float* normalSHCoeff,
+        float* modelColors) const;
+
+    unsigned int getProbeCount() const;
+};
+
+#endif
@@ -4,47 +4,94 @@
 #include <cstdlib>
 
 Model::Model():
-    vertexPointer(NULL),
-    normalPointer(NULL),
     indexPointer(NULL),
     triangleCount(0),
     vertexCount(0)
 {
 }
 
-Model::Model(const std::string& filePath) {
-    this->loadFromFile(filePath);
+Model::Model(const std::string& filePath, unsigned int transferStride):
+    indexPointer(NULL),
+    triangleCount(0),
+    vertexCount(0)
+{
+    this->loadFromFile(filePath, transferStride);
 }
 
 Model::~Model() {
-    if (this->vertexCount > 0) {
-        if (this->vertexPointer != NULL) delete[] this->vertexPointer;
-        if (this->normalPointer != NULL) delete[] this->normalPointer;
-    }
+    this->release();
+}
 
-    if (this->triangleCount > 0) {
-        if (this->indexPointer != NULL) delete[] this->indexPointer;
-    }
+void Model::release() {
+    delete[] this->indexPointer;
+    this->indexPointer = NULL;
+
+    this->vertexStream.release();
+
+    this->triangleCount = 0;
+    this->vertexCount = 0;
+}
+
+void Model::swap(Model& other) {
+    this->vertexStream.swap(other.vertexStream);
+
+    unsigned short* indexPointer = this->indexPointer;
+    unsigned short triangleCount = this->triangleCount;
+    unsigned short vertexCount = this->vertexCount;
+
+    this->indexPointer = other.indexPointer;
+    this->triangleCount = other.triangleCount;
+    this->vertexCount = other.vertexCount;
+
+    other.indexPointer = indexPointer;
+    other.triangleCount = triangleCount;
+    other.vertexCount = vertexCount;
 }
 
-void Model::loadFromFile(const std::string& filePath) {
+// loading again reuses the vertex stream allocation when it is large enough
+
+bool Model::loadFromFile(const std::string& filePath, unsigned int transferStride) {
+    delete[] this->indexPointer;
+    this->indexPointer = NULL;
+
     Lib3dsFile* file = lib3ds_file_open(filePath.c_str());
-    Lib3dsMesh* mesh = file->meshes[0];
+    if (file == NULL) {
+        this->release();
+        return false;
+    }
+
+    Lib3dsMesh* mesh = (file->nmeshes > 0 && file->meshes != NULL) ? file->meshes[0] : NULL;
+    if (mesh == NULL) {
+        lib3ds_file_free(file);
+        this->release();
+        return false;
+    }
 
     this->vertexCount = mesh->nvertices;
-    this->vertexPointer = new float[3 * this->vertexCount];
+    if (!this->vertexStream.allocate(this->vertexCount, transferStride)) {
+        lib3ds_file_free(file);
+        this->release();
+        return false;
+    }
+
+    float* vertexPointer = this->vertexStream.getPositionPointer();
+    float* normalPointer = this->vertexStream.getNormalPointer();
 
     for (int iter = 0; iter < this->vertexCount; ++iter) {
-        this->vertexPointer[3 * iter + 0] = mesh->vertices[iter][0];
-        this->vertexPointer[3 * iter + 1] = mesh->vertices[iter][1];
-        this->vertexPointer[3 * iter + 2] = mesh->vertices[iter][2];
+        vertexPointer[3 * iter + 0] = mesh->vertices[iter][0];
+        vertexPointer[3 * iter + 1] = mesh->vertices[iter][1];
+        vertexPointer[3 * iter + 2] = mesh->vertices[iter][2];
     }
 
     this->triangleCount = mesh->nfaces;
     this->indexPointer = new unsigned short[3 * this->triangleCount];
 
-    this->normalPointer = new float[3 * this->vertexCount];
     float (*faceNormals)[3] = (float(*)[3])malloc(3 * 3 * triangleCount * sizeof(float)); // yikes!
+    if (faceNormals == NULL) {
+        lib3ds_file_free(file);
+        this->release();
+        return false;
+    }
 
     lib3ds_mesh_calculate_vertex_normals(mesh, faceNormals);
 
@@ -63,29 +110,38 @@ void Model::loadFromFile(const std::string& filePath) {
         int indexC = this->indexPointer[3 * iter + 2];
 
         for (int dim = 0; dim < 3; ++dim) {
-            this->normalPointer[3 * indexA + dim] = faceNormals[3 * iter + 0][dim];
-            this->normalPointer[3 * indexB + dim] = faceNormals[3 * iter + 1][dim];
-            this->normalPointer[3 * indexC + dim] = faceNormals[3 * iter + 2][dim];
+            normalPointer[3 * indexA + dim] = faceNormals[3 * iter + 0][dim];
+            normalPointer[3 * indexB + dim] = faceNormals[3 * iter + 1][dim];
+            normalPointer[3 * indexC + dim] = faceNormals[3 * iter + 2][dim];
         }
     }
 
     free(faceNormals);
 
     lib3ds_file_free(file);
+    return true;
 }
 
 const float* Model::getVertexPointer() const {
-    return this->vertexPointer;
+    return this->vertexStream.getPositionPointer();
 }
 
 const float* Model::getNormalPointer() const {
-    return this->normalPointer;
+    return this->vertexStream.getNormalPointer();
 }
 
 const unsigned short* Model::getIndexPointer() const {
     return this->indexPointer;
 }
 
+VertexStream& Model::getVertexStream() {
+    return this->vertexStream;
+}
+
+const VertexStream& Model::getVertexStream() const {
+    return this->vertexStream;
+}
+
 unsigned short Model::getTriangleCount() const {
     return this->triangleCount;
 }
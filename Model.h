@@ -1,11 +1,13 @@
 #ifndef _MODEL_H_
 #define _MODEL_H_
 
+#include "HarmonicBasisCount.h"
+#include "VertexStream.h"
+
 #include <string>
 
 class Model {
-    float* vertexPointer;
-    float* normalPointer;
+    VertexStream vertexStream;
     unsigned short* indexPointer;
 
   // based on lib3ds, so maximum number of vertices and triangles is 2^16
@@ -13,18 +15,29 @@ class Model {
     unsigned short triangleCount;
     unsigned short vertexCount;
 
+  // models own their buffers, ownership is moved with swap
+    Model(const Model&);
+    Model& operator=(const Model&);
+
 public:
     Model();
-    Model(const std::string& filePath);
+    Model(const std::string& filePath, unsigned int transferStride = BASIS_FUNCTION_COUNT);
 
     ~Model();
 
-    void loadFromFile(const std::string& filePath);
+  // returns false, leaving the model empty, if the file cannot be read or holds no mesh
+    bool loadFromFile(const std::string& filePath, unsigned int transferStride = BASIS_FUNCTION_COUNT);
+    void release();
+    void swap(Model& other);
 
     const float* getVertexPointer() const;
     const float* getNormalPointer() const;
     const unsigned short* getIndexPointer() const;
 
+  // transfer coefficients and colors live alongside positions and normals
+    VertexStream& getVertexStream();
+    const VertexStream& getVertexStream() const;
+
     unsigned short getTriangleCount() const;
     unsigned short getVertexCount() const;
 };
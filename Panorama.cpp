@@ -0,0 +1,330 @@
+#include "Panorama.h"
+#include "SphericalHarmonics.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+PanoramaReader::PanoramaReader():
+    file(NULL),
+    width(0),
+    height(0),
+    rowsRead(0),
+    radiance(false),
+    bottomUp(false),
+    channelCount(3),
+    swapBytes(false)
+{
+}
+
+PanoramaReader::~PanoramaReader() {
+    this->close();
+}
+
+bool PanoramaReader::open(const std::string& filePath) {
+    this->close();
+
+    this->file = fopen(filePath.c_str(), "rb");
+    if (this->file == NULL) return false;
+
+    char magic[2];
+    if (fread(magic, 1, 2, this->file) != 2) {
+        this->close();
+        return false;
+    }
+
+    bool opened = false;
+    if (magic[0] == '#' && magic[1] == '?') opened = this->openRadiance();
+    else if (magic[0] == 'P' && (magic[1] == 'F' || magic[1] == 'f')) {
+        this->channelCount = (magic[1] == 'F') ? 3 : 1;
+        opened = this->openPortableFloatMap();
+    }
+
+    if (!opened || this->width == 0 || this->height == 0) {
+        this->close();
+        return false;
+    }
+
+    return true;
+}
+
+void PanoramaReader::close() {
+    if (this->file != NULL) fclose(this->file);
+
+    this->file = NULL;
+    this->width = 0;
+    this->height = 0;
+    this->rowsRead = 0;
+}
+
+// header lines up to an empty line, then a resolution line such as "-Y 1024 +X 2048"
+
+bool PanoramaReader::openRadiance() {
+    this->radiance = true;
+
+    char line[256];
+    bool rgbeFormat = true;
+
+  // rest of the magic line
+    if (fgets(line, sizeof(line), this->file) == NULL) return false;
+
+    while (fgets(line, sizeof(line), this->file) != NULL) {
+        if (line[0] == '\n' || line[0] == '\r') break;
+        if (strncmp(line, "FORMAT=", 7) == 0 && strncmp(line + 7, "32-bit_rle_rgbe", 15) != 0) rgbeFormat = false;
+    }
+
+    if (!rgbeFormat) return false;
+    if (fgets(line, sizeof(line), this->file) == NULL) return false;
+
+    char ySign, xSign;
+    int height, width;
+    if (sscanf(line, "%cY %d %cX %d", &ySign, &height, &xSign, &width) != 4) return false;
+    if (xSign != '+' || height <= 0 || width <= 0) return false;
+
+    this->bottomUp = (ySign == '+');
+    this->width = width;
+    this->height = height;
+
+    this->encodedRow.resize(4 * this->width);
+    return true;
+}
+
+// "PF" or "Pf", dimensions, then a scale whose sign gives the byte order; rows are stored bottom to top
+
+bool PanoramaReader::openPortableFloatMap() {
+    this->radiance = false;
+    this->bottomUp = true;
+
+    int width, height;
+    float scale;
+    if (fscanf(this->file, "%d %d %f", &width, &height, &scale) != 3) return false;
+    if (width <= 0 || height <= 0) return false;
+
+  // exactly one whitespace character separates the header from the data
+    fgetc(this->file);
+
+    unsigned int test = 1;
+    bool hostLittleEndian = (*(unsigned char*)&test == 1);
+    this->swapBytes = ((scale < 0.f) != hostLittleEndian);
+
+    this->width = width;
+    this->height = height;
+
+    this->rawRow.resize(this->channelCount * this->width);
+    return true;
+}
+
+bool PanoramaReader::readRow(float* row, unsigned int& rowIndex) {
+    if (this->file == NULL || this->rowsRead >= this->height) return false;
+
+    bool success = this->radiance ? this->readRadianceRow(row) : this->readPortableFloatMapRow(row);
+    if (!success) return false;
+
+    rowIndex = this->bottomUp ? this->height - 1 - this->rowsRead : this->rowsRead;
+    this->rowsRead++;
+
+    return true;
+}
+
+/*
+   new style scanlines start with 2, 2 and the width, followed by each of the 4 channels run-length encoded
+   anything else is a flat scanline, possibly with old style (1, 1, 1, count) repeat markers
+*/
+bool PanoramaReader::readRadianceRow(float* row) {
+    unsigned char* encoded = &this->encodedRow[0];
+
+    unsigned char start[4];
+    if (fread(start, 1, 4, this->file) != 4) return false;
+
+    bool newStyle = (start[0] == 2 && start[1] == 2 && (start[2] & 0x80) == 0 &&
+        this->width >= 8 && this->width < 32768);
+
+    if (newStyle) {
+        if (((unsigned int)start[2] << 8 | start[3]) != this->width) return false;
+
+        for (int channel = 0; channel < 4; channel++) {
+            unsigned int pixel = 0;
+
+            while (pixel < this->width) {
+                int count = fgetc(this->file);
+                if (count == EOF) return false;
+
+                if (count > 128) {
+                    count -= 128;
+                    int value = fgetc(this->file);
+                    if (value == EOF || pixel + count > this->width) return false;
+
+                    for (int iter = 0; iter < count; iter++) encoded[4 * pixel++ + channel] = (unsigned char)value;
+                }
+                else {
+                    if (count == 0 || pixel + count > this->width) return false;
+
+                    for (int iter = 0; iter < count; iter++) {
+                        int value = fgetc(this->file);
+                        if (value == EOF) return false;
+                        encoded[4 * pixel++ + channel] = (unsigned char)value;
+                    }
+                }
+            }
+        }
+    }
+    else {
+        memcpy(encoded, start, 4);
+
+        unsigned int pixel = 1;
+        int shift = 0;
+
+        while (pixel < this->width) {
+            unsigned char* current = &encoded[4 * pixel];
+            if (fread(current, 1, 4, this->file) != 4) return false;
+
+            if (current[0] == 1 && current[1] == 1 && current[2] == 1) {
+                unsigned int count = (unsigned int)current[3] << shift;
+                if (pixel + count > this->width) return false;
+
+                for (unsigned int iter = 0; iter < count; iter++) {
+                    memcpy(&encoded[4 * pixel], &encoded[4 * (pixel - 1)], 4);
+                    pixel++;
+                }
+
+                shift += 8;
+            }
+            else {
+                pixel++;
+                shift = 0;
+            }
+        }
+    }
+
+    for (unsigned int pixel = 0; pixel < this->width; pixel++) {
+        const unsigned char* rgbe = &encoded[4 * pixel];
+
+        if (rgbe[3] == 0) {
+            row[3 * pixel + 0] = row[3 * pixel + 1] = row[3 * pixel + 2] = 0.f;
+        }
+        else {
+            float factor = (float)ldexp(1.0, (int)rgbe[3] - (128 + 8));
+            row[3 * pixel + 0] = rgbe[0] * factor;
+            row[3 * pixel + 1] = rgbe[1] * factor;
+            row[3 * pixel + 2] = rgbe[2] * factor;
+        }
+    }
+
+    return true;
+}
+
+bool PanoramaReader::readPortableFloatMapRow(float* row) {
+    float* raw = &this->rawRow[0];
+    unsigned int valueCount = this->channelCount * this->width;
+
+    if (fread(raw, sizeof(float), valueCount, this->file) != valueCount) return false;
+
+    if (this->swapBytes) {
+        for (unsigned int iter = 0; iter < valueCount; iter++) {
+            unsigned char* bytes = (unsigned char*)&raw[iter];
+            unsigned char swap;
+            swap = bytes[0]; bytes[0] = bytes[3]; bytes[3] = swap;
+            swap = bytes[1]; bytes[1] = bytes[2]; bytes[2] = swap;
+        }
+    }
+
+    for (unsigned int pixel = 0; pixel < this->width; pixel++) {
+        for (int channel = 0; channel < 3; channel++) {
+            row[3 * pixel + channel] = (this->channelCount == 3) ? raw[3 * pixel + channel] : raw[pixel];
+        }
+    }
+
+    return true;
+}
+
+unsigned int PanoramaReader::getWidth() const {
+    return this->width;
+}
+
+unsigned int PanoramaReader::getHeight() const {
+    return this->height;
+}
+
+/*
+   a row between theta0 and theta1 covers a solid angle of 2pi * (cos(theta0) - cos(theta1)),
+   shared evenly by its pixels, so every row is summed on its own and then weighted
+   sums are kept in double precision since very large panoramas have hundreds of millions of pixels
+*/
+bool calculatePanoramaCoefficients(const std::string& filePath, sf::Vector3f* panoramaSHCoeff) {
+    PanoramaReader reader;
+    if (!reader.open(filePath)) return false;
+
+    unsigned int width = reader.getWidth();
+    unsigned int height = reader.getHeight();
+
+    std::vector<float> row(3 * width);
+    std::vector<float> sinPhi(width);
+    std::vector<float> cosPhi(width);
+
+  // directions and basis values of the current row, for the basis block kernel
+    std::vector<float> x(width), y(width), z(width);
+    std::vector<float> basisValues(BASIS_FUNCTION_COUNT * width);
+
+    for (unsigned int column = 0; column < width; column++) {
+        float phi = 2.f * M_PI * (column + 0.5f) / (float)width;
+        sinPhi[column] = sin(phi);
+        cosPhi[column] = cos(phi);
+    }
+
+    double totals[BASIS_FUNCTION_COUNT][3];
+    for (int basis = 0; basis < BASIS_FUNCTION_COUNT; basis++)
+        totals[basis][0] = totals[basis][1] = totals[basis][2] = 0.0;
+
+    unsigned int rowIndex = 0;
+    unsigned int rowCount = 0;
+
+    while (reader.readRow(&row[0], rowIndex)) {
+        double theta0 = M_PI * rowIndex / (double)height;
+        double theta1 = M_PI * (rowIndex + 1) / (double)height;
+        double pixelSolidAngle = 2.0 * M_PI * (cos(theta0) - cos(theta1)) / (double)width;
+
+        float theta = M_PI * (rowIndex + 0.5f) / (float)height;
+        float sinTheta = sin(theta);
+        float cosTheta = cos(theta);
+
+        double rowSums[BASIS_FUNCTION_COUNT][3];
+        for (int basis = 0; basis < BASIS_FUNCTION_COUNT; basis++)
+            rowSums[basis][0] = rowSums[basis][1] = rowSums[basis][2] = 0.0;
+
+        for (unsigned int column = 0; column < width; column++) {
+            x[column] = sinTheta * sinPhi[column];
+            y[column] = cosTheta;
+            z[column] = sinTheta * cosPhi[column];
+        }
+
+        calculateHarmonicBasisBlock(width, &x[0], &y[0], &z[0], &basisValues[0], width);
+
+        for (int basis = 0; basis < BASIS_FUNCTION_COUNT; basis++) {
+            const float* values = &basisValues[basis * width];
+
+            for (unsigned int column = 0; column < width; column++) {
+                const float* color = &row[3 * column];
+                rowSums[basis][0] += color[0] * values[column];
+                rowSums[basis][1] += color[1] * values[column];
+                rowSums[basis][2] += color[2] * values[column];
+            }
+        }
+
+        for (int basis = 0; basis < BASIS_FUNCTION_COUNT; basis++) {
+            for (int channel = 0; channel < 3; channel++)
+                totals[basis][channel] += rowSums[basis][channel] * pixelSolidAngle;
+        }
+
+        rowCount++;
+    }
+
+    if (rowCount != height) return false;
+
+    for (int basis = 0; basis < BASIS_FUNCTION_COUNT; basis++) {
+        panoramaSHCoeff[basis].x = (float)totals[basis][0];
+        panoramaSHCoeff[basis].y = (float)totals[basis][1];
+        panoramaSHCoeff[basis].z = (float)totals[basis][2];
+    }
+
+    return true;
+}
@@ -0,0 +1,60 @@
+#ifndef _PANORAMA_H_
+#define _PANORAMA_H_
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include <SFML/System/Vector3.hpp>
+
+/*
+   reads an equirectangular panorama one row at a time, so memory use only depends on the width
+   supports Radiance RGBE (.hdr, flat or run-length encoded) and PFM (.pfm, color or grayscale)
+   rows are delivered in file order as 3 floats per pixel, along with their index counted from the top
+*/
+class PanoramaReader {
+    FILE* file;
+    unsigned int width;
+    unsigned int height;
+    unsigned int rowsRead;
+
+    bool radiance;
+    bool bottomUp;
+
+  // PFM specific
+    unsigned int channelCount;
+    bool swapBytes;
+
+  // scratch buffers reused for every row
+    std::vector<unsigned char> encodedRow;
+    std::vector<float> rawRow;
+
+    bool openRadiance();
+    bool openPortableFloatMap();
+    bool readRadianceRow(float* row);
+    bool readPortableFloatMapRow(float* row);
+
+    PanoramaReader(const PanoramaReader&);
+    PanoramaReader& operator=(const PanoramaReader&);
+
+public:
+    PanoramaReader();
+    ~PanoramaReader();
+
+    bool open(const std::string& filePath);
+    void close();
+
+  // reads the next row of the file, returns false at the end or on a decoding error
+    bool readRow(float* row, unsigned int& rowIndex);
+
+    unsigned int getWidth() const;
+    unsigned int getHeight() const;
+};
+
+/*
+   projects a panorama onto the basis functions while it streams in, weighting every row by its solid angle
+   the top row is +Y and columns sweep phi from +Z towards +X, matching SphericalFunction::integrate
+*/
+bool calculatePanoramaCoefficients(const std::string& filePath, sf::Vector3f* panoramaSHCoeff);
+
+#endif
@@ -0,0 +1,520 @@
+#include "ProjectionService.h"
+#include "CubemapProjection.h"
+#include "Shading.h"
+#include "SphericalHarmonics.h"
+#include "VisibilityTransfer.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+#include <sstream>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+
+// a request line has to arrive within this long, so a slow or idle client cannot hold up the ones queued behind it
+static const int CONNECTION_TIMEOUT_SECONDS = 5;
+static const unsigned int MAXIMUM_REQUEST_LENGTH = 4096;
+
+static double getSeconds() {
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec * 1e-9;
+}
+
+// reads one newline-terminated request, pending keeps whatever arrived after it
+// returns false once the client disconnects, or misses the deadline for the whole line
+static bool readLine(int connection, std::string& pending, std::string& line) {
+    double deadline = getSeconds() + CONNECTION_TIMEOUT_SECONDS;
+
+    while (true) {
+        size_t end = pending.find('\n');
+        bool closed = false;
+
+        if (end == std::string::npos) {
+            if (pending.size() > MAXIMUM_REQUEST_LENGTH) return false;
+
+            double remaining = deadline - getSeconds();
+            if (remaining <= 0.0) return false;
+
+            pollfd descriptor;
+            descriptor.fd = connection;
+            descriptor.events = POLLIN;
+            descriptor.revents = 0;
+
+            int ready = poll(&descriptor, 1, (int)(remaining * 1000.0) + 1);
+            if (ready < 0 && errno == EINTR) continue;
+            if (ready <= 0) return false;
+
+            char buffer[1024];
+            ssize_t received = recv(connection, buffer, sizeof(buffer), 0);
+            if (received < 0 && errno == EINTR) continue;
+            if (received < 0) return false;
+
+          // a last request without a newline still counts
+            if (received == 0) {
+                if (pending.empty()) return false;
+                closed = true;
+                end = pending.size();
+            }
+            else {
+                pending.append(buffer, received);
+                continue;
+            }
+        }
+
+        line.clear();
+        for (size_t iter = 0; iter < end; iter++) {
+            if (pending[iter] != '\r') line += pending[iter];
+        }
+        pending.erase(0, closed ? end : end + 1);
+
+        return true;
+    }
+}
+
+static void writeLine(int connection, const std::string& line) {
+    std::string message = line + "\n";
+    const char* data = message.c_str();
+    size_t remaining = message.size();
+
+    while (remaining > 0) {
+        ssize_t written = send(connection, data, remaining, 0);
+        if (written <= 0) return;
+        data += written;
+        remaining -= written;
+    }
+}
+
+// least recently used entry outside the current request, or end if every entry is in use
+template <typename Map>
+static typename Map::iterator findLeastRecent(Map& entries, unsigned long currentUse) {
+    typename Map::iterator leastRecent = entries.end();
+
+    for (typename Map::iterator iter = entries.begin(); iter != entries.end(); ++iter) {
+        if (iter->second.lastUse == currentUse) continue;
+        if (leastRecent == entries.end() || iter->second.lastUse < leastRecent->second.lastUse) leastRecent = iter;
+    }
+
+    return leastRecent;
+}
+
+const unsigned int ProjectionService::MAXIMUM_CUBEMAPS;
+const unsigned int ProjectionService::MAXIMUM_MODELS;
+const unsigned int ProjectionService::MAXIMUM_QUADRATURES;
+const size_t ProjectionService::MAXIMUM_SHARED_BYTES;
+
+ProjectionService::ProjectionService(int threadCount):
+    sharedByteCount(0),
+    useCounter(0),
+    threadCount(threadCount),
+    sharedMemoryCounter(0),
+    running(false)
+{
+}
+
+ProjectionService::~ProjectionService() {
+    this->evict();
+}
+
+void ProjectionService::evict() {
+    for (std::map<std::string, CacheEntry<Cubemap*> >::iterator iter = this->cubemaps.begin();
+        iter != this->cubemaps.end(); ++iter)
+    {
+        delete iter->second.value;
+    }
+    for (std::map<std::string, CacheEntry<Model*> >::iterator iter = this->models.begin();
+        iter != this->models.end(); ++iter)
+    {
+        delete iter->second.value;
+    }
+    for (std::map<Resolution, CacheEntry<SphericalQuadrature*> >::iterator iter = this->quadratures.begin();
+        iter != this->quadratures.end(); ++iter)
+    {
+        delete iter->second.value;
+    }
+
+    for (std::map<ProjectionKey, SharedBlock>::iterator iter = this->cubemapCoefficients.begin();
+        iter != this->cubemapCoefficients.end(); ++iter)
+    {
+        this->releaseBlock(iter->second);
+    }
+    for (std::map<ProjectionKey, SharedBlock>::iterator iter = this->modelCoefficients.begin();
+        iter != this->modelCoefficients.end(); ++iter)
+    {
+        this->releaseBlock(iter->second);
+    }
+    for (std::map<std::string, SharedBlock>::iterator iter = this->shadedColors.begin();
+        iter != this->shadedColors.end(); ++iter)
+    {
+        this->releaseBlock(iter->second);
+    }
+
+    this->cubemaps.clear();
+    this->models.clear();
+    this->quadratures.clear();
+    this->cubemapCoefficients.clear();
+    this->modelCoefficients.clear();
+    this->shadedColors.clear();
+}
+
+Cubemap* ProjectionService::getCubemap(const std::string& directory) {
+    std::map<std::string, CacheEntry<Cubemap*> >::iterator found = this->cubemaps.find(directory);
+    if (found != this->cubemaps.end()) {
+        found->second.lastUse = this->useCounter;
+        return found->second.value;
+    }
+
+  // faces are only decoded, the service never creates textures and needs no OpenGL context
+    Cubemap* cubemap = new Cubemap();
+    if (!cubemap->loadFromDirectory(directory)) {
+        delete cubemap;
+        return NULL;
+    }
+
+    while (this->cubemaps.size() >= MAXIMUM_CUBEMAPS) {
+        std::map<std::string, CacheEntry<Cubemap*> >::iterator leastRecent =
+            findLeastRecent(this->cubemaps, this->useCounter);
+        if (leastRecent == this->cubemaps.end()) break;
+
+        delete leastRecent->second.value;
+        this->cubemaps.erase(leastRecent);
+    }
+
+    CacheEntry<Cubemap*>& entry = this->cubemaps[directory];
+    entry.value = cubemap;
+    entry.lastUse = this->useCounter;
+    return cubemap;
+}
+
+Model* ProjectionService::getModel(const std::string& path) {
+    std::map<std::string, CacheEntry<Model*> >::iterator found = this->models.find(path);
+    if (found != this->models.end()) {
+        found->second.lastUse = this->useCounter;
+        return found->second.value;
+    }
+
+    Model* model = new Model();
+    if (!model->loadFromFile(path)) {
+        delete model;
+        return NULL;
+    }
+
+    while (this->models.size() >= MAXIMUM_MODELS) {
+        std::map<std::string, CacheEntry<Model*> >::iterator leastRecent =
+            findLeastRecent(this->models, this->useCounter);
+        if (leastRecent == this->models.end()) break;
+
+        delete leastRecent->second.value;
+        this->models.erase(leastRecent);
+    }
+
+    CacheEntry<Model*>& entry = this->models[path];
+    entry.value = model;
+    entry.lastUse = this->useCounter;
+    return model;
+}
+
+const SphericalQuadrature& ProjectionService::getQuadrature(unsigned int thetaResolution, unsigned int phiResolution) {
+    Resolution resolution(thetaResolution, phiResolution);
+
+    std::map<Resolution, CacheEntry<SphericalQuadrature*> >::iterator found = this->quadratures.find(resolution);
+    if (found != this->quadratures.end()) {
+        found->second.lastUse = this->useCounter;
+        return *found->second.value;
+    }
+
+    while (this->quadratures.size() >= MAXIMUM_QUADRATURES) {
+        std::map<Resolution, CacheEntry<SphericalQuadrature*> >::iterator leastRecent =
+            findLeastRecent(this->quadratures, this->useCounter);
+        if (leastRecent == this->quadratures.end()) break;
+
+        delete leastRecent->second.value;
+        this->quadratures.erase(leastRecent);
+    }
+
+    CacheEntry<SphericalQuadrature*>& entry = this->quadratures[resolution];
+    entry.value = new SphericalQuadrature(thetaResolution, phiResolution);
+    entry.lastUse = this->useCounter;
+    return *entry.value;
+}
+
+// creates and maps a new shared memory object for count floats, making room under MAXIMUM_SHARED_BYTES first
+bool ProjectionService::createBlock(unsigned int count, SharedBlock& block) {
+    std::ostringstream name;
+    name << "/SphericalHarmonicsService." << getpid() << "." << this->sharedMemoryCounter++;
+
+    block.name = name.str();
+    block.values = NULL;
+    block.count = count;
+    block.byteCount = (size_t)count * sizeof(float);
+    block.lastUse = this->useCounter;
+
+    this->makeRoom(block.byteCount);
+
+    int descriptor = shm_open(block.name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (descriptor < 0) return false;
+
+    if (block.byteCount > 0) {
+        void* mapping = MAP_FAILED;
+        if (ftruncate(descriptor, block.byteCount) == 0)
+            mapping = mmap(NULL, block.byteCount, PROT_READ | PROT_WRITE, MAP_SHARED, descriptor, 0);
+
+        if (mapping == MAP_FAILED) {
+            close(descriptor);
+            shm_unlink(block.name.c_str());
+            return false;
+        }
+
+        block.values = (float*)mapping;
+    }
+
+    close(descriptor);
+
+    this->sharedByteCount += block.byteCount;
+    return true;
+}
+
+void ProjectionService::releaseBlock(SharedBlock& block) {
+    if (block.values != NULL) munmap(block.values, block.byteCount);
+    shm_unlink(block.name.c_str());
+
+    this->sharedByteCount -= block.byteCount;
+    block.values = NULL;
+}
+
+// drops the least recently used results of earlier requests until byteCount more fits
+void ProjectionService::makeRoom(size_t byteCount) {
+    while (this->sharedByteCount + byteCount > MAXIMUM_SHARED_BYTES) {
+        std::map<ProjectionKey, SharedBlock>::iterator cubemapBlock =
+            findLeastRecent(this->cubemapCoefficients, this->useCounter);
+        std::map<ProjectionKey, SharedBlock>::iterator modelBlock =
+            findLeastRecent(this->modelCoefficients, this->useCounter);
+        std::map<std::string, SharedBlock>::iterator shadedBlock =
+            findLeastRecent(this->shadedColors, this->useCounter);
+
+        unsigned long cubemapUse = (cubemapBlock != this->cubemapCoefficients.end()) ? cubemapBlock->second.lastUse : 0;
+        unsigned long modelUse = (modelBlock != this->modelCoefficients.end()) ? modelBlock->second.lastUse : 0;
+        unsigned long shadedUse = (shadedBlock != this->shadedColors.end()) ? shadedBlock->second.lastUse : 0;
+
+        bool hasCubemap = cubemapBlock != this->cubemapCoefficients.end();
+        bool hasModel = modelBlock != this->modelCoefficients.end();
+        bool hasShaded = shadedBlock != this->shadedColors.end();
+
+        if (hasCubemap && (!hasModel || cubemapUse <= modelUse) && (!hasShaded || cubemapUse <= shadedUse)) {
+            this->releaseBlock(cubemapBlock->second);
+            this->cubemapCoefficients.erase(cubemapBlock);
+        }
+        else if (hasModel && (!hasShaded || modelUse <= shadedUse)) {
+            this->releaseBlock(modelBlock->second);
+            this->modelCoefficients.erase(modelBlock);
+        }
+        else if (hasShaded) {
+            this->releaseBlock(shadedBlock->second);
+            this->shadedColors.erase(shadedBlock);
+        }
+        else {
+            break;
+        }
+    }
+}
+
+const ProjectionService::SharedBlock* ProjectionService::getCubemapCoefficients(const std::string& directory,
+    unsigned int thetaResolution, unsigned int phiResolution)
+{
+    ProjectionKey key(directory, Resolution(thetaResolution, phiResolution));
+
+    std::map<ProjectionKey, SharedBlock>::iterator found = this->cubemapCoefficients.find(key);
+    if (found != this->cubemapCoefficients.end()) {
+        found->second.lastUse = this->useCounter;
+        return &found->second;
+    }
+
+    Cubemap* cubemap = this->getCubemap(directory);
+    if (cubemap == NULL) return NULL;
+
+    sf::Vector3f cubemapSHCoeff[BASIS_FUNCTION_COUNT];
+    calculateCubemapCoefficients(*cubemap, this->getQuadrature(thetaResolution, phiResolution), cubemapSHCoeff,
+        this->threadCount);
+
+    SharedBlock block;
+    if (!this->createBlock(3 * BASIS_FUNCTION_COUNT, block)) return NULL;
+
+    for (int basis = 0; basis < BASIS_FUNCTION_COUNT; basis++) {
+        block.values[3 * basis + 0] = cubemapSHCoeff[basis].x;
+        block.values[3 * basis + 1] = cubemapSHCoeff[basis].y;
+        block.values[3 * basis + 2] = cubemapSHCoeff[basis].z;
+    }
+
+    return &(this->cubemapCoefficients[key] = block);
+}
+
+const ProjectionService::SharedBlock* ProjectionService::getModelCoefficients(const std::string& path,
+    unsigned int thetaResolution, unsigned int phiResolution)
+{
+    ProjectionKey key(path, Resolution(thetaResolution, phiResolution));
+
+    std::map<ProjectionKey, SharedBlock>::iterator found = this->modelCoefficients.find(key);
+    if (found != this->modelCoefficients.end()) {
+        found->second.lastUse = this->useCounter;
+        return &found->second;
+    }
+
+    Model* model = this->getModel(path);
+    if (model == NULL) return NULL;
+
+  // the bake writes straight into the shared object
+    SharedBlock block;
+    if (!this->createBlock(BASIS_FUNCTION_COUNT * model->getVertexCount(), block)) return NULL;
+
+    if (block.count > 0) {
+        calculateVisibilityCoefficients(model->getNormalPointer(), model->getVertexCount(), block.values,
+            thetaResolution, phiResolution, this->threadCount);
+    }
+
+    return &(this->modelCoefficients[key] = block);
+}
+
+std::string ProjectionService::respond(const SharedBlock& block) {
+    std::ostringstream response;
+    response << "ok " << block.name << " " << block.byteCount;
+    return response.str();
+}
+
+std::string ProjectionService::handleRequest(const std::string& request) {
+    this->useCounter++;
+
+    std::istringstream input(request);
+    std::string command;
+    input >> command;
+
+    if (command == "project-cubemap" || command == "project-model") {
+        std::string path;
+        unsigned int thetaResolution = 0, phiResolution = 0;
+        input >> path >> thetaResolution >> phiResolution;
+
+        if (input.fail() || thetaResolution == 0 || phiResolution == 0) return "error malformed request";
+
+        const SharedBlock* coefficients = (command == "project-cubemap") ?
+            this->getCubemapCoefficients(path, thetaResolution, phiResolution) :
+            this->getModelCoefficients(path, thetaResolution, phiResolution);
+
+        if (coefficients == NULL) return "error could not load " + path;
+        return this->respond(*coefficients);
+    }
+
+    if (command == "shade") {
+        std::string path, directory;
+        float angle = 0.f;
+        input >> path >> directory >> angle;
+
+        if (input.fail()) return "error malformed request";
+
+        std::ostringstream key;
+        key.precision(9);
+        key << path << "\n" << directory << "\n" << angle;
+
+        std::map<std::string, SharedBlock>::iterator found = this->shadedColors.find(key.str());
+        if (found != this->shadedColors.end()) {
+            found->second.lastUse = this->useCounter;
+            return this->respond(found->second);
+        }
+
+        const SharedBlock* normalSHCoeff = this->getModelCoefficients(path, 16, 32);
+        if (normalSHCoeff == NULL) return "error could not load " + path;
+
+        const SharedBlock* cubemapCoefficients = this->getCubemapCoefficients(directory, 256, 512);
+        if (cubemapCoefficients == NULL) return "error could not load " + directory;
+
+        sf::Vector3f cubemapSHCoeff[BASIS_FUNCTION_COUNT];
+        for (int basis = 0; basis < BASIS_FUNCTION_COUNT; basis++) {
+            cubemapSHCoeff[basis].x = cubemapCoefficients->values[3 * basis + 0];
+            cubemapSHCoeff[basis].y = cubemapCoefficients->values[3 * basis + 1];
+            cubemapSHCoeff[basis].z = cubemapCoefficients->values[3 * basis + 2];
+        }
+
+        sf::Vector3f shadingSHCoeff[BASIS_FUNCTION_COUNT];
+        prepareShadingCoefficients(angle, cubemapSHCoeff, shadingSHCoeff);
+
+        unsigned int vertexCount = normalSHCoeff->count / BASIS_FUNCTION_COUNT;
+
+        SharedBlock block;
+        if (!this->createBlock(3 * vertexCount, block)) return "error could not create shared memory";
+
+        if (vertexCount > 0) calculateModelColors(vertexCount, block.values, normalSHCoeff->values, shadingSHCoeff);
+        return this->respond(this->shadedColors[key.str()] = block);
+    }
+
+    if (command == "evict") {
+        this->evict();
+        return "ok";
+    }
+
+    if (command == "quit") {
+        this->running = false;
+        return "ok";
+    }
+
+    return "error unknown command " + command;
+}
+
+bool ProjectionService::run(const std::string& socketPath) {
+    sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+
+    if (socketPath.size() >= sizeof(address.sun_path)) {
+        std::cout << "socket path too long: " << socketPath << std::endl;
+        return false;
+    }
+    strcpy(address.sun_path, socketPath.c_str());
+
+    int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listener < 0) return false;
+
+  // a stale socket file from a previous run would make bind fail
+    unlink(socketPath.c_str());
+
+    if (bind(listener, (sockaddr*)&address, sizeof(address)) != 0 || listen(listener, 64) != 0) {
+        std::cout << "could not listen on " << socketPath << std::endl;
+        close(listener);
+        return false;
+    }
+
+    std::cout << "listening on " << socketPath << std::endl;
+
+  // connections are served one at a time, so the caches need no locking
+  // each request line and each write has a deadline, so an idle, slow or stuck client only delays the next one briefly
+    this->running = true;
+    while (this->running) {
+        int connection = accept(listener, NULL, NULL);
+        if (connection < 0) continue;
+
+        timeval timeout;
+        timeout.tv_sec = CONNECTION_TIMEOUT_SECONDS;
+        timeout.tv_usec = 0;
+        setsockopt(connection, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+        std::string pending, request;
+        while (this->running && readLine(connection, pending, request)) {
+            if (request.empty()) continue;
+            writeLine(connection, this->handleRequest(request));
+        }
+
+        close(connection);
+    }
+
+    close(listener);
+    unlink(socketPath.c_str());
+
+    return true;
+}
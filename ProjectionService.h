@@ -0,0 +1,107 @@
+#ifndef _PROJECTIONSERVICE_H_
+#define _PROJECTIONSERVICE_H_
+
+#include "Cubemap.h"
+#include "Model.h"
+#include "SphericalFunction.h"
+
+#include <cstddef>
+#include <map>
+#include <string>
+#include <utility>
+
+#include <SFML/System/Vector3.hpp>
+
+/*
+   resident projection engine listening on a Unix domain socket (POSIX only)
+   decoded cubemaps, models, quadrature tables and projected coefficients stay cached between requests,
+   each cache is bounded and drops its least recently used entries first
+
+   requests are single lines of text, one response line per request:
+    -project-cubemap <directory> <thetaResolution> <phiResolution>
+      BASIS_FUNCTION_COUNT x 3 floats of cubemap coefficients
+    -project-model <path> <thetaResolution> <phiResolution>
+      BASIS_FUNCTION_COUNT floats of visibility coefficients per vertex
+    -shade <path> <directory> <angle>
+      3 floats of color per vertex, using 16x32 for the model and 256x512 for the cubemap
+    -evict
+      drops every cache
+    -quit
+      stops the service
+
+   responses are "ok <sharedMemoryName> <byteCount>" or "error <message>"
+   results are computed straight into named POSIX shared memory objects owned by the service, and the same
+   object is named again for as long as the result stays cached, so clients map it read-only instead of
+   receiving a copy; objects are unlinked when evicted or when the service stops (existing mappings stay valid)
+   clients must not unlink them
+*/
+class ProjectionService {
+    typedef std::pair<unsigned int, unsigned int> Resolution;
+    typedef std::pair<std::string, Resolution> ProjectionKey;
+
+    template <typename T>
+    struct CacheEntry {
+        T value;
+        unsigned long lastUse;
+    };
+
+  // a result living in its own shared memory object, mapped for as long as it is cached
+    struct SharedBlock {
+        std::string name;
+        float* values;
+        unsigned int count;
+        size_t byteCount;
+        unsigned long lastUse;
+    };
+
+    std::map<std::string, CacheEntry<Cubemap*> > cubemaps;
+    std::map<std::string, CacheEntry<Model*> > models;
+    std::map<Resolution, CacheEntry<SphericalQuadrature*> > quadratures;
+
+    std::map<ProjectionKey, SharedBlock> cubemapCoefficients;
+    std::map<ProjectionKey, SharedBlock> modelCoefficients;
+    std::map<std::string, SharedBlock> shadedColors;
+    size_t sharedByteCount;
+
+  // every request advances the use counter, entries used by the current request are never evicted
+    unsigned long useCounter;
+
+    int threadCount;
+    unsigned int sharedMemoryCounter;
+    bool running;
+
+    Cubemap* getCubemap(const std::string& directory);
+    Model* getModel(const std::string& path);
+    const SphericalQuadrature& getQuadrature(unsigned int thetaResolution, unsigned int phiResolution);
+
+    const SharedBlock* getCubemapCoefficients(const std::string& directory,
+        unsigned int thetaResolution, unsigned int phiResolution);
+    const SharedBlock* getModelCoefficients(const std::string& path,
+        unsigned int thetaResolution, unsigned int phiResolution);
+
+    bool createBlock(unsigned int count, SharedBlock& block);
+    void releaseBlock(SharedBlock& block);
+    void makeRoom(size_t byteCount);
+
+    std::string handleRequest(const std::string& request);
+    std::string respond(const SharedBlock& block);
+
+    ProjectionService(const ProjectionService&);
+    ProjectionService& operator=(const ProjectionService&);
+
+public:
+    static const unsigned int MAXIMUM_CUBEMAPS = 8;
+    static const unsigned int MAXIMUM_MODELS = 8;
+    static const unsigned int MAXIMUM_QUADRATURES = 8;
+    static const size_t MAXIMUM_SHARED_BYTES = (size_t)256 << 20;
+
+    ProjectionService(int threadCount);
+    ~ProjectionService();
+
+  // blocks until a quit request arrives, returns false if the socket could not be set up
+    bool run(const std::string& socketPath);
+
+    void evict();
+};
+
+#endif
@@ -0,0 +1,615 @@
+#include "ProxyTransfer.h"
+#include "SphericalHarmonics.h"
+#include "VisibilityTransfer.h"
+
+#include <cmath>
+#include <map>
+#include <set>
+
+// cube face a normal points to, 0 to 5
+static unsigned int getNormalBin(const float* normal) {
+    unsigned int axis = 0;
+    if (fabs(normal[1]) > fabs(normal[axis])) axis = 1;
+    if (fabs(normal[2]) > fabs(normal[axis])) axis = 2;
+    return 2 * axis + (normal[axis] < 0.f ? 1 : 0);
+}
+
+// axis-aligned bounds, returns the length of the longest side
+static float calculateBounds(const float* vertexPointer, unsigned int vertexCount, float* minimum, float* maximum) {
+    for (int axis = 0; axis < 3; axis++) {
+        minimum[axis] = (vertexCount > 0) ? vertexPointer[axis] : 0.f;
+        maximum[axis] = minimum[axis];
+    }
+
+    for (unsigned int iter = 1; iter < vertexCount; iter++) {
+        for (int axis = 0; axis < 3; axis++) {
+            float value = vertexPointer[3 * iter + axis];
+            if (value < minimum[axis]) minimum[axis] = value;
+            if (value > maximum[axis]) maximum[axis] = value;
+        }
+    }
+
+    float longest = 0.f;
+    for (int axis = 0; axis < 3; axis++) {
+        if (maximum[axis] - minimum[axis] > longest) longest = maximum[axis] - minimum[axis];
+    }
+
+    return longest;
+}
+
+// proxy mesh methods
+
+struct ClusterKey {
+    unsigned int cell;
+    unsigned int normalBin;
+
+    bool operator<(const ClusterKey& other) const {
+        if (cell != other.cell) return cell < other.cell;
+        return normalBin < other.normalBin;
+    }
+};
+
+// sums gathered for one cluster, the quadric is kept as its 3x3 part (upper triangle) and linear part
+struct ClusterSums {
+    double quadric[6];
+    double linear[3];
+    double position[3];
+    double normal[3];
+    unsigned int count;
+};
+
+/*
+   each triangle adds its plane, weighted by area, to the quadrics of the clusters of its corners
+   the placement minimizes the quadric plus a small pull towards the centroid, which settles
+   the directions a flat or straight cluster leaves open without moving it off its planes
+*/
+void ProxyMesh::build(const float* vertexPointer, const float* normalPointer, unsigned int vertexCount,
+    const unsigned short* indexPointer, unsigned int triangleCount, unsigned int gridResolution)
+{
+    this->positions.clear();
+    this->normals.clear();
+    this->indices.clear();
+    this->clusters.assign(vertexCount, 0);
+
+    if (vertexCount == 0) return;
+    if (gridResolution < 1) gridResolution = 1;
+    if (gridResolution > 1024) gridResolution = 1024;
+
+    float minimum[3], maximum[3];
+    float longest = calculateBounds(vertexPointer, vertexCount, minimum, maximum);
+    float cellSize = (longest > 0.f) ? longest / gridResolution : 1.f;
+
+    std::map<ClusterKey, unsigned int> clusterIndices;
+    std::vector<ClusterSums> sums;
+
+    for (unsigned int iter = 0; iter < vertexCount; iter++) {
+        unsigned int cell[3];
+        for (int axis = 0; axis < 3; axis++) {
+            int index = (int)((vertexPointer[3 * iter + axis] - minimum[axis]) / cellSize);
+            if (index < 0) index = 0;
+            if (index >= (int)gridResolution) index = gridResolution - 1;
+            cell[axis] = index;
+        }
+
+        ClusterKey key;
+        key.cell = cell[0] + gridResolution * (cell[1] + gridResolution * cell[2]);
+        key.normalBin = getNormalBin(&normalPointer[3 * iter]);
+
+        std::map<ClusterKey, unsigned int>::iterator found = clusterIndices.find(key);
+        if (found == clusterIndices.end()) {
+            ClusterSums empty;
+            for (int entry = 0; entry < 6; entry++) empty.quadric[entry] = 0.0;
+            for (int axis = 0; axis < 3; axis++) empty.linear[axis] = empty.position[axis] = empty.normal[axis] = 0.0;
+            empty.count = 0;
+
+            found = clusterIndices.insert(std::make_pair(key, (unsigned int)sums.size())).first;
+            sums.push_back(empty);
+        }
+
+        unsigned int cluster = found->second;
+        this->clusters[iter] = cluster;
+
+        for (int axis = 0; axis < 3; axis++) {
+            sums[cluster].position[axis] += vertexPointer[3 * iter + axis];
+            sums[cluster].normal[axis] += normalPointer[3 * iter + axis];
+        }
+        sums[cluster].count++;
+    }
+
+    std::set<std::vector<unsigned int> > proxyTriangles;
+
+    for (unsigned int iter = 0; iter < triangleCount; iter++) {
+        const float* a = &vertexPointer[3 * indexPointer[3 * iter + 0]];
+        const float* b = &vertexPointer[3 * indexPointer[3 * iter + 1]];
+        const float* c = &vertexPointer[3 * indexPointer[3 * iter + 2]];
+
+        double ab[3], ac[3], cross[3];
+        for (int axis = 0; axis < 3; axis++) {
+            ab[axis] = b[axis] - a[axis];
+            ac[axis] = c[axis] - a[axis];
+        }
+        cross[0] = ab[1] * ac[2] - ab[2] * ac[1];
+        cross[1] = ab[2] * ac[0] - ab[0] * ac[2];
+        cross[2] = ab[0] * ac[1] - ab[1] * ac[0];
+
+        double length = sqrt(cross[0] * cross[0] + cross[1] * cross[1] + cross[2] * cross[2]);
+        if (length > 0.0) {
+            double area = 0.5 * length;
+            double plane[3] = { cross[0] / length, cross[1] / length, cross[2] / length };
+            double offset = -(plane[0] * a[0] + plane[1] * a[1] + plane[2] * a[2]);
+
+            for (int corner = 0; corner < 3; corner++) {
+                ClusterSums& cluster = sums[this->clusters[indexPointer[3 * iter + corner]]];
+
+                cluster.quadric[0] += area * plane[0] * plane[0];
+                cluster.quadric[1] += area * plane[0] * plane[1];
+                cluster.quadric[2] += area * plane[0] * plane[2];
+                cluster.quadric[3] += area * plane[1] * plane[1];
+                cluster.quadric[4] += area * plane[1] * plane[2];
+                cluster.quadric[5] += area * plane[2] * plane[2];
+                for (int axis = 0; axis < 3; axis++) cluster.linear[axis] += area * offset * plane[axis];
+            }
+        }
+
+      // triangles collapsed by the clustering are dropped, the rest keep their winding
+        unsigned int clusterA = this->clusters[indexPointer[3 * iter + 0]];
+        unsigned int clusterB = this->clusters[indexPointer[3 * iter + 1]];
+        unsigned int clusterC = this->clusters[indexPointer[3 * iter + 2]];
+        if (clusterA == clusterB || clusterB == clusterC || clusterC == clusterA) continue;
+
+        std::vector<unsigned int> triangle(3);
+        triangle[0] = clusterA;
+        triangle[1] = clusterB;
+        triangle[2] = clusterC;
+
+      // rotate the smallest index to the front, so each triangle is only stored once
+        while (triangle[0] > triangle[1] || triangle[0] > triangle[2]) {
+            unsigned int first = triangle[0];
+            triangle[0] = triangle[1];
+            triangle[1] = triangle[2];
+            triangle[2] = first;
+        }
+
+        if (proxyTriangles.insert(triangle).second) {
+            this->indices.push_back(triangle[0]);
+            this->indices.push_back(triangle[1]);
+            this->indices.push_back(triangle[2]);
+        }
+    }
+
+    unsigned int clusterCount = sums.size();
+    this->positions.resize(3 * clusterCount);
+    this->normals.resize(3 * clusterCount);
+
+    for (unsigned int cluster = 0; cluster < clusterCount; cluster++) {
+        const ClusterSums& sum = sums[cluster];
+
+        double centroid[3];
+        for (int axis = 0; axis < 3; axis++) centroid[axis] = sum.position[axis] / sum.count;
+
+        double trace = sum.quadric[0] + sum.quadric[3] + sum.quadric[5];
+        double pull = 1e-3 * trace;
+
+        double position[3] = { centroid[0], centroid[1], centroid[2] };
+
+        if (trace > 0.0) {
+          // (A + pull * I) p = -b + pull * centroid, solved with Cramer's rule
+            double m00 = sum.quadric[0] + pull, m01 = sum.quadric[1], m02 = sum.quadric[2];
+            double m11 = sum.quadric[3] + pull, m12 = sum.quadric[4];
+            double m22 = sum.quadric[5] + pull;
+
+            double r[3];
+            for (int axis = 0; axis < 3; axis++) r[axis] = -sum.linear[axis] + pull * centroid[axis];
+
+            double determinant = m00 * (m11 * m22 - m12 * m12) - m01 * (m01 * m22 - m12 * m02) +
+                m02 * (m01 * m12 - m11 * m02);
+
+            if (fabs(determinant) > 0.0) {
+                position[0] = (r[0] * (m11 * m22 - m12 * m12) - m01 * (r[1] * m22 - m12 * r[2]) +
+                    m02 * (r[1] * m12 - m11 * r[2])) / determinant;
+                position[1] = (m00 * (r[1] * m22 - m12 * r[2]) - r[0] * (m01 * m22 - m12 * m02) +
+                    m02 * (m01 * r[2] - r[1] * m02)) / determinant;
+                position[2] = (m00 * (m11 * r[2] - r[1] * m12) - m01 * (m01 * r[2] - r[1] * m02) +
+                    r[0] * (m01 * m12 - m11 * m02)) / determinant;
+            }
+        }
+
+        double normalLength = sqrt(sum.normal[0] * sum.normal[0] + sum.normal[1] * sum.normal[1] +
+            sum.normal[2] * sum.normal[2]);
+
+        for (int axis = 0; axis < 3; axis++) {
+            this->positions[3 * cluster + axis] = (float)position[axis];
+            this->normals[3 * cluster + axis] = (normalLength > 0.0) ? (float)(sum.normal[axis] / normalLength) : 0.f;
+        }
+    }
+}
+
+const float* ProxyMesh::getVertexPointer() const {
+    return this->positions.empty() ? NULL : &this->positions[0];
+}
+
+const float* ProxyMesh::getNormalPointer() const {
+    return this->normals.empty() ? NULL : &this->normals[0];
+}
+
+const unsigned int* ProxyMesh::getIndexPointer() const {
+    return this->indices.empty() ? NULL : &this->indices[0];
+}
+
+const unsigned int* ProxyMesh::getClusterPointer() const {
+    return this->clusters.empty() ? NULL : &this->clusters[0];
+}
+
+unsigned int ProxyMesh::getVertexCount() const {
+    return this->positions.size() / 3;
+}
+
+unsigned int ProxyMesh::getTriangleCount() const {
+    return this->indices.size() / 3;
+}
+
+// triangle grid methods
+
+static float dot(const float* a, const float* b) {
+    return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+// barycentric coordinates of the closest point on triangle abc (Ericson, Real-Time Collision Detection 5.1.5)
+static void calculateClosestPoint(const float* p, const float* a, const float* b, const float* c, float* barycentric) {
+    float ab[3], ac[3], ap[3], bp[3], cp[3];
+    for (int axis = 0; axis < 3; axis++) {
+        ab[axis] = b[axis] - a[axis];
+        ac[axis] = c[axis] - a[axis];
+        ap[axis] = p[axis] - a[axis];
+        bp[axis] = p[axis] - b[axis];
+        cp[axis] = p[axis] - c[axis];
+    }
+
+    barycentric[0] = 1.f;
+    barycentric[1] = 0.f;
+    barycentric[2] = 0.f;
+
+    float d1 = dot(ab, ap), d2 = dot(ac, ap);
+    if (d1 <= 0.f && d2 <= 0.f) return;
+
+    float d3 = dot(ab, bp), d4 = dot(ac, bp);
+    if (d3 >= 0.f && d4 <= d3) {
+        barycentric[0] = 0.f;
+        barycentric[1] = 1.f;
+        return;
+    }
+
+    float vc = d1 * d4 - d3 * d2;
+    if (vc <= 0.f && d1 >= 0.f && d3 <= 0.f && d1 - d3 > 0.f) {
+        float v = d1 / (d1 - d3);
+        barycentric[0] = 1.f - v;
+        barycentric[1] = v;
+        return;
+    }
+
+    float d5 = dot(ab, cp), d6 = dot(ac, cp);
+    if (d6 >= 0.f && d5 <= d6) {
+        barycentric[0] = 0.f;
+        barycentric[2] = 1.f;
+        return;
+    }
+
+    float vb = d5 * d2 - d1 * d6;
+    if (vb <= 0.f && d2 >= 0.f && d6 <= 0.f && d2 - d6 > 0.f) {
+        float w = d2 / (d2 - d6);
+        barycentric[0] = 1.f - w;
+        barycentric[2] = w;
+        return;
+    }
+
+    float va = d3 * d6 - d5 * d4;
+    if (va <= 0.f && d4 - d3 >= 0.f && d5 - d6 >= 0.f && (d4 - d3) + (d5 - d6) > 0.f) {
+        float w = (d4 - d3) / ((d4 - d3) + (d5 - d6));
+        barycentric[0] = 0.f;
+        barycentric[1] = 1.f - w;
+        barycentric[2] = w;
+        return;
+    }
+
+    float total = va + vb + vc;
+    if (total <= 0.f) return;
+
+    barycentric[1] = vb / total;
+    barycentric[2] = vc / total;
+    barycentric[0] = 1.f - barycentric[1] - barycentric[2];
+}
+
+TriangleGrid::TriangleGrid():
+    vertexPointer(NULL),
+    normalPointer(NULL),
+    indexPointer(NULL),
+    cellSize(1.f)
+{
+    for (int axis = 0; axis < 3; axis++) {
+        this->minimum[axis] = 0.f;
+        this->dimensions[axis] = 0;
+    }
+}
+
+void TriangleGrid::build(const float* vertexPointer, const float* normalPointer, const unsigned int* indexPointer,
+    unsigned int triangleCount, unsigned int gridResolution)
+{
+    this->vertexPointer = vertexPointer;
+    this->normalPointer = normalPointer;
+    this->indexPointer = indexPointer;
+
+    this->cellStarts.clear();
+    this->cellTriangles.clear();
+    for (int axis = 0; axis < 3; axis++) this->dimensions[axis] = 0;
+
+    if (triangleCount == 0) return;
+    if (gridResolution < 1) gridResolution = 1;
+    if (gridResolution > 1024) gridResolution = 1024;
+
+  // bounds of the vertices used by triangles
+    float maximum[3];
+    for (int axis = 0; axis < 3; axis++) {
+        this->minimum[axis] = maximum[axis] = vertexPointer[3 * indexPointer[0] + axis];
+    }
+    for (unsigned int corner = 1; corner < 3 * triangleCount; corner++) {
+        for (int axis = 0; axis < 3; axis++) {
+            float value = vertexPointer[3 * indexPointer[corner] + axis];
+            if (value < this->minimum[axis]) this->minimum[axis] = value;
+            if (value > maximum[axis]) maximum[axis] = value;
+        }
+    }
+
+    float longest = 0.f;
+    for (int axis = 0; axis < 3; axis++) {
+        if (maximum[axis] - this->minimum[axis] > longest) longest = maximum[axis] - this->minimum[axis];
+    }
+    this->cellSize = (longest > 0.f) ? longest / gridResolution : 1.f;
+
+    unsigned int cellCount = 1;
+    for (int axis = 0; axis < 3; axis++) {
+        this->dimensions[axis] = (unsigned int)((maximum[axis] - this->minimum[axis]) / this->cellSize) + 1;
+        if (this->dimensions[axis] > gridResolution) this->dimensions[axis] = gridResolution;
+        cellCount *= this->dimensions[axis];
+    }
+
+  // counted first, then filled, so every cell's list is contiguous
+    std::vector<unsigned int> cellRanges(6 * triangleCount);
+    this->cellStarts.assign(cellCount + 1, 0);
+
+    for (int pass = 0; pass < 2; pass++) {
+        std::vector<unsigned int> cellFill;
+        if (pass == 1) {
+            for (unsigned int cell = 0; cell < cellCount; cell++) this->cellStarts[cell + 1] += this->cellStarts[cell];
+            this->cellTriangles.resize(this->cellStarts[cellCount]);
+            cellFill.assign(this->cellStarts.begin(), this->cellStarts.end() - 1);
+        }
+
+        for (unsigned int triangle = 0; triangle < triangleCount; triangle++) {
+            unsigned int* range = &cellRanges[6 * triangle];
+
+            if (pass == 0) {
+                for (int axis = 0; axis < 3; axis++) {
+                    float low = vertexPointer[3 * indexPointer[3 * triangle] + axis];
+                    float high = low;
+                    for (int corner = 1; corner < 3; corner++) {
+                        float value = vertexPointer[3 * indexPointer[3 * triangle + corner] + axis];
+                        if (value < low) low = value;
+                        if (value > high) high = value;
+                    }
+
+                    range[axis] = (unsigned int)((low - this->minimum[axis]) / this->cellSize);
+                    range[3 + axis] = (unsigned int)((high - this->minimum[axis]) / this->cellSize);
+                    if (range[3 + axis] >= this->dimensions[axis]) range[3 + axis] = this->dimensions[axis] - 1;
+                    if (range[axis] > range[3 + axis]) range[axis] = range[3 + axis];
+                }
+            }
+
+            for (unsigned int z = range[2]; z <= range[5]; z++) {
+                for (unsigned int y = range[1]; y <= range[4]; y++) {
+                    for (unsigned int x = range[0]; x <= range[3]; x++) {
+                        unsigned int cell = x + this->dimensions[0] * (y + this->dimensions[1] * z);
+                        if (pass == 0) this->cellStarts[cell + 1]++;
+                        else this->cellTriangles[cellFill[cell]++] = triangle;
+                    }
+                }
+            }
+        }
+    }
+}
+
+/*
+   cells are visited in growing cubic rings around the cell of the point, a ring r + 1 cell is at least
+   r cells away from a point inside the grid, so the search stops once the best distance is below that
+   (less the distance of a point outside the grid from its bounds)
+*/
+bool TriangleGrid::findClosest(const float* point, const float* normal, unsigned int& triangle,
+    float* barycentric) const
+{
+    if (this->cellTriangles.empty()) return false;
+
+    int center[3];
+    float outsideSquared = 0.f;
+
+    for (int axis = 0; axis < 3; axis++) {
+        float offset = point[axis] - this->minimum[axis];
+        float extent = this->dimensions[axis] * this->cellSize;
+
+        if (offset < 0.f) outsideSquared += offset * offset;
+        if (offset > extent) outsideSquared += (offset - extent) * (offset - extent);
+
+        int cell = (int)floor(offset / this->cellSize);
+        if (cell < 0) cell = 0;
+        if (cell >= (int)this->dimensions[axis]) cell = this->dimensions[axis] - 1;
+        center[axis] = cell;
+    }
+    float outside = sqrt(outsideSquared);
+
+    bool foundFacing = false, foundAny = false;
+    float bestFacing = 0.f, bestAny = 0.f;
+    unsigned int facingTriangle = 0, anyTriangle = 0;
+    float facingBarycentric[3] = {0.f, 0.f, 0.f}, anyBarycentric[3] = {0.f, 0.f, 0.f};
+
+    int maximumRing = this->dimensions[0];
+    if ((int)this->dimensions[1] > maximumRing) maximumRing = this->dimensions[1];
+    if ((int)this->dimensions[2] > maximumRing) maximumRing = this->dimensions[2];
+
+    for (int ring = 0; ring <= maximumRing; ring++) {
+        for (int z = center[2] - ring; z <= center[2] + ring; z++) {
+            if (z < 0 || z >= (int)this->dimensions[2]) continue;
+
+            for (int y = center[1] - ring; y <= center[1] + ring; y++) {
+                if (y < 0 || y >= (int)this->dimensions[1]) continue;
+
+              // inside the ring only the two x ends belong to it
+                bool shell = (z == center[2] - ring || z == center[2] + ring || y == center[1] - ring || y == center[1] + ring);
+                int step = (shell || ring == 0) ? 1 : 2 * ring;
+
+                for (int x = center[0] - ring; x <= center[0] + ring; x += step) {
+                    if (x < 0 || x >= (int)this->dimensions[0]) continue;
+
+                    unsigned int cell = x + this->dimensions[0] * (y + this->dimensions[1] * z);
+
+                    for (unsigned int entry = this->cellStarts[cell]; entry < this->cellStarts[cell + 1]; entry++) {
+                        unsigned int candidate = this->cellTriangles[entry];
+                        const unsigned int* corners = &this->indexPointer[3 * candidate];
+
+                        float weights[3];
+                        calculateClosestPoint(point, &this->vertexPointer[3 * corners[0]],
+                            &this->vertexPointer[3 * corners[1]], &this->vertexPointer[3 * corners[2]], weights);
+
+                        float closest[3], interpolatedNormal[3];
+                        for (int axis = 0; axis < 3; axis++) {
+                            closest[axis] = interpolatedNormal[axis] = 0.f;
+                            for (int corner = 0; corner < 3; corner++) {
+                                closest[axis] += weights[corner] * this->vertexPointer[3 * corners[corner] + axis];
+                                interpolatedNormal[axis] += weights[corner] * this->normalPointer[3 * corners[corner] + axis];
+                            }
+                        }
+
+                        float distanceSquared = 0.f;
+                        for (int axis = 0; axis < 3; axis++)
+                            distanceSquared += (closest[axis] - point[axis]) * (closest[axis] - point[axis]);
+
+                        if (!foundAny || distanceSquared < bestAny) {
+                            foundAny = true;
+                            bestAny = distanceSquared;
+                            anyTriangle = candidate;
+                            for (int corner = 0; corner < 3; corner++) anyBarycentric[corner] = weights[corner];
+                        }
+
+                        if (dot(interpolatedNormal, normal) > 0.f && (!foundFacing || distanceSquared < bestFacing)) {
+                            foundFacing = true;
+                            bestFacing = distanceSquared;
+                            facingTriangle = candidate;
+                            for (int corner = 0; corner < 3; corner++) facingBarycentric[corner] = weights[corner];
+                        }
+                    }
+                }
+            }
+        }
+
+        float reach = ring * this->cellSize - outside;
+        if (foundFacing && reach > 0.f && bestFacing <= reach * reach) break;
+    }
+
+    if (!foundAny) return false;
+
+    if (foundFacing) {
+        triangle = facingTriangle;
+        for (int corner = 0; corner < 3; corner++) barycentric[corner] = facingBarycentric[corner];
+    }
+    else {
+        triangle = anyTriangle;
+        for (int corner = 0; corner < 3; corner++) barycentric[corner] = anyBarycentric[corner];
+    }
+
+    return true;
+}
+
+// proxy bake
+
+void calculateVisibilityCoefficientsProxy(const float* vertexPointer, const float* normalPointer,
+    unsigned int vertexCount, const unsigned short* indexPointer, unsigned int triangleCount,
+    float* coefficientPointer, unsigned int gridResolution, unsigned int thetaResolution, unsigned int phiResolution,
+    int threadCount, unsigned int sampleCount, ProxyTransferReport& report)
+{
+    report.proxyVertexCount = 0;
+    report.proxyTriangleCount = 0;
+    report.sampleCount = 0;
+    report.maximumError = 0.f;
+    report.rmsError = 0.f;
+
+    if (vertexCount == 0) return;
+
+    ProxyMesh proxy;
+    proxy.build(vertexPointer, normalPointer, vertexCount, indexPointer, triangleCount, gridResolution);
+
+    report.proxyVertexCount = proxy.getVertexCount();
+    report.proxyTriangleCount = proxy.getTriangleCount();
+
+    std::vector<float> proxyCoefficients(BASIS_FUNCTION_COUNT * proxy.getVertexCount());
+    calculateVisibilityCoefficients(proxy.getNormalPointer(), proxy.getVertexCount(), &proxyCoefficients[0],
+        thetaResolution, phiResolution, threadCount);
+
+  // the index uses the same resolution as the clustering, so cells hold a handful of proxy triangles
+    TriangleGrid grid;
+    grid.build(proxy.getVertexPointer(), proxy.getNormalPointer(), proxy.getIndexPointer(),
+        proxy.getTriangleCount(), gridResolution);
+
+    const unsigned int* clusters = proxy.getClusterPointer();
+
+    for (unsigned int iter = 0; iter < vertexCount; iter++) {
+        float* coefficients = &coefficientPointer[BASIS_FUNCTION_COUNT * iter];
+
+        unsigned int triangle;
+        float barycentric[3];
+
+        if (grid.findClosest(&vertexPointer[3 * iter], &normalPointer[3 * iter], triangle, barycentric)) {
+            const unsigned int* corners = &proxy.getIndexPointer()[3 * triangle];
+
+            for (int basis = 0; basis < BASIS_FUNCTION_COUNT; basis++) {
+                coefficients[basis] = 0.f;
+                for (int corner = 0; corner < 3; corner++)
+                    coefficients[basis] += barycentric[corner] * proxyCoefficients[BASIS_FUNCTION_COUNT * corners[corner] + basis];
+            }
+        }
+        else {
+          // no proxy triangles at all, fall back to the vertex's own cluster
+            for (int basis = 0; basis < BASIS_FUNCTION_COUNT; basis++)
+                coefficients[basis] = proxyCoefficients[BASIS_FUNCTION_COUNT * clusters[iter] + basis];
+        }
+    }
+
+  // exact coefficients for evenly spaced vertices
+    if (sampleCount == 0) return;
+    if (sampleCount > vertexCount) sampleCount = vertexCount;
+
+    unsigned int stride = vertexCount / sampleCount;
+    std::vector<float> sampleNormals(3 * sampleCount);
+    std::vector<float> sampleCoefficients(BASIS_FUNCTION_COUNT * sampleCount);
+
+    for (unsigned int sample = 0; sample < sampleCount; sample++) {
+        for (int axis = 0; axis < 3; axis++) sampleNormals[3 * sample + axis] = normalPointer[3 * stride * sample + axis];
+    }
+
+    calculateVisibilityCoefficients(&sampleNormals[0], sampleCount, &sampleCoefficients[0],
+        thetaResolution, phiResolution, threadCount);
+
+    double squaredTotal = 0.0;
+
+    for (unsigned int sample = 0; sample < sampleCount; sample++) {
+        double squaredError = 0.0;
+        for (int basis = 0; basis < BASIS_FUNCTION_COUNT; basis++) {
+            double difference = coefficientPointer[BASIS_FUNCTION_COUNT * stride * sample + basis] -
+                sampleCoefficients[BASIS_FUNCTION_COUNT * sample + basis];
+            squaredError += difference * difference;
+        }
+
+        float error = (float)sqrt(squaredError);
+        if (error > report.maximumError) report.maximumError = error;
+        squaredTotal += squaredError;
+    }
+
+    report.sampleCount = sampleCount;
+    report.rmsError = (float)sqrt(squaredTotal / sampleCount);
+}
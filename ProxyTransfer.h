@@ -0,0 +1,86 @@
+#ifndef _PROXYTRANSFER_H_
+#define _PROXYTRANSFER_H_
+
+#include <vector>
+
+/*
+   simplified stand-in for a dense mesh, made by vertex clustering with quadric placement:
+   vertices are grouped by grid cell and by the cube face their normal points to (so both sides of a thin
+   shell, or of a crease, stay apart), each group becomes one vertex placed where the squared distances to
+   the planes of its triangles are smallest, and triangles spanning three groups are kept
+*/
+class ProxyMesh {
+    std::vector<float> positions;
+    std::vector<float> normals;
+    std::vector<unsigned int> indices;
+
+  // proxy vertex of every original vertex
+    std::vector<unsigned int> clusters;
+
+public:
+  // gridResolution cells along the longest side of the bounding box
+    void build(const float* vertexPointer, const float* normalPointer, unsigned int vertexCount,
+        const unsigned short* indexPointer, unsigned int triangleCount, unsigned int gridResolution);
+
+    const float* getVertexPointer() const;
+    const float* getNormalPointer() const;
+    const unsigned int* getIndexPointer() const;
+    const unsigned int* getClusterPointer() const;
+
+    unsigned int getVertexCount() const;
+    unsigned int getTriangleCount() const;
+};
+
+/*
+   uniform grid of cubic cells over a triangle mesh, every cell lists the triangles whose bounds overlap it
+   queries search rings of cells around the point until no closer triangle can exist
+*/
+class TriangleGrid {
+    const float* vertexPointer;
+    const float* normalPointer;
+    const unsigned int* indexPointer;
+
+    float minimum[3];
+    float cellSize;
+    unsigned int dimensions[3];
+
+  // triangles of cell c are cellTriangles[cellStarts[c]] up to cellTriangles[cellStarts[c + 1]]
+    std::vector<unsigned int> cellStarts;
+    std::vector<unsigned int> cellTriangles;
+
+public:
+    TriangleGrid();
+
+  // the mesh is referenced, not copied
+    void build(const float* vertexPointer, const float* normalPointer, const unsigned int* indexPointer,
+        unsigned int triangleCount, unsigned int gridResolution);
+
+  // closest triangle to the point whose interpolated normal faces the same way as the given one,
+  // or the closest of any orientation if none does; false, leaving triangle and barycentric untouched,
+  // if the grid holds no triangles
+    bool findClosest(const float* point, const float* normal, unsigned int& triangle, float* barycentric) const;
+};
+
+// spread of coefficient errors over sampled full-resolution vertices
+struct ProxyTransferReport {
+    unsigned int proxyVertexCount;
+    unsigned int proxyTriangleCount;
+    unsigned int sampleCount;
+
+  // Euclidean norm of the coefficient error per vertex, which bounds the shading error for
+  // lighting coefficients of unit norm (scale by the norm of the prepared coefficients otherwise)
+    float maximumError;
+    float rmsError;
+};
+
+/*
+   bakes visibility coefficients on a proxy of the mesh, then gives every vertex the barycentric blend
+   of the proxy coefficients at the closest point on the proxy, so bake time scales with the proxy size
+   up to sampleCount vertices are also baked exactly to fill in the report
+*/
+void calculateVisibilityCoefficientsProxy(const float* vertexPointer, const float* normalPointer,
+    unsigned int vertexCount, const unsigned short* indexPointer, unsigned int triangleCount,
+    float* coefficientPointer, unsigned int gridResolution, unsigned int thetaResolution, unsigned int phiResolution,
+    int threadCount, unsigned int sampleCount, ProxyTransferReport& report);
+
+#endif
@@ -0,0 +1,69 @@
+#include "Shading.h"
+#include "SphericalHarmonics.h"
+
+#include <cmath>
+
+/*
+   rotates the cubemap coefficients by the given angle and normalizes them for shading,
+   so that every shading kernel (calculateModelColors, CompressedTransfer) is a plain dot product
+*/
+void prepareShadingCoefficients(float angle, const sf::Vector3f* cubemapSHCoeff, sf::Vector3f* shadingSHCoeff) {
+  // needed because cos/sin evaluate to double and fail Vector3 template matching
+  // but also creates slight gain in efficiency, so that's cool!
+    float cosAngle = cos(angle);
+    float sinAngle = sin(angle);
+    float cosAngle2 = cos(2.f * angle);
+    float sinAngle2 = sin(2.f * angle);
+
+  /*
+     rotation currently assumes there are exactly 9 basis functions (most likely true)
+     also, it only allows rotation around Z axis right now
+     will need the +/-90 degree rotations about X axis for ZYZ rotations (Z,X-90,Z,X+90,Z)
+     also, will want better organization to perform rotations easier
+  */
+    shadingSHCoeff[0] = cubemapSHCoeff[0];
+
+    shadingSHCoeff[1] = cosAngle * cubemapSHCoeff[1] + sinAngle * cubemapSHCoeff[3];
+    shadingSHCoeff[2] = cubemapSHCoeff[2];
+    shadingSHCoeff[3] = -sinAngle * cubemapSHCoeff[1] + cosAngle * cubemapSHCoeff[3];
+
+    shadingSHCoeff[4] = cosAngle2 * cubemapSHCoeff[4] + sinAngle2 * cubemapSHCoeff[8];
+    shadingSHCoeff[5] = cosAngle * cubemapSHCoeff[5] + sinAngle * cubemapSHCoeff[7];
+    shadingSHCoeff[6] = cubemapSHCoeff[6];
+    shadingSHCoeff[7] = -sinAngle * cubemapSHCoeff[5] + cosAngle * cubemapSHCoeff[7];
+    shadingSHCoeff[8] = -sinAngle2 * cubemapSHCoeff[4] + cosAngle2 * cubemapSHCoeff[8];
+
+  /*
+     dot product of coefficients is approximation of dot product times cubemap functions
+     to get average color for vertex, divide by domain of integral (2pi x pi)
+     however, average of dot product times cubemap will be too dark (most samples are zero)
+     integral of dot product times sine is pi, so multiplying by 2pi fixes this
+     since integral will be "brought up" to 2pi x pi and average "brought up" to 1 (at max)
+  */
+    for (int basis = 0; basis < BASIS_FUNCTION_COUNT; basis++) {
+        shadingSHCoeff[basis] /= (float)(4.f * M_PI);
+        shadingSHCoeff[basis] *= 4.f; // correction for dot product
+    }
+}
+
+/*
+   current function for getting per-vertex colors based on spherical harmonics lighting
+   takes normal coefficients and prepared cubemap coefficients and performs dot product
+*/
+void calculateModelColors(unsigned int vertexCount, float* modelColors,
+    const float* normalSHCoeff, const sf::Vector3f* shadingSHCoeff)
+{
+    for (int iter = 0; iter < vertexCount; iter++) {
+        sf::Vector3f vertexColor(0.f, 0.f, 0.f);
+
+      // the per-color-channel dot product of cubemap coefficients and visibility coefficients
+        for (int basis = 0; basis < BASIS_FUNCTION_COUNT; basis++) {
+            vertexColor += shadingSHCoeff[basis] *
+                normalSHCoeff[BASIS_FUNCTION_COUNT * iter + basis];
+        }
+
+        modelColors[3 * iter + 0] = vertexColor.x;
+        modelColors[3 * iter + 1] = vertexColor.y;
+        modelColors[3 * iter + 2] = vertexColor.z;
+    }
+}
@@ -0,0 +1,13 @@
+#ifndef _SHADING_H_
+#define _SHADING_H_
+
+#include <SFML/System/Vector3.hpp>
+
+// rotated and normalized cubemap coefficients, shared by every shading kernel
+void prepareShadingCoefficients(float angle, const sf::Vector3f* cubemapSHCoeff, sf::Vector3f* shadingSHCoeff);
+
+// per-vertex colors from normal coefficients and prepared cubemap coefficients
+void calculateModelColors(unsigned int vertexCount, float* modelColors,
+    const float* normalSHCoeff, const sf::Vector3f* shadingSHCoeff);
+
+#endif
@@ -0,0 +1,89 @@
+#include "ShadingCache.h"
+
+#include <cmath>
+
+ShadingCache::ShadingCache(unsigned int valueCount, size_t byteBudget):
+    valueCount(valueCount),
+    byteBudget(byteBudget)
+{
+    size_t minimumBudget = 2 * valueCount * sizeof(float);
+    if (this->byteBudget < minimumBudget) this->byteBudget = minimumBudget;
+}
+
+const float* ShadingCache::find(unsigned long key) {
+    std::map<unsigned long, Entry>::iterator found = this->entries.find(key);
+    if (found == this->entries.end()) return NULL;
+
+    this->recentKeys.splice(this->recentKeys.begin(), this->recentKeys, found->second.recentPosition);
+
+    return &found->second.colors[0];
+}
+
+float* ShadingCache::insert(unsigned long key) {
+    std::map<unsigned long, Entry>::iterator found = this->entries.find(key);
+
+    if (found == this->entries.end()) {
+      // evict least recently used entries until the new buffer fits
+        while (!this->recentKeys.empty() && this->getByteCount() + this->valueCount * sizeof(float) > this->byteBudget) {
+            this->entries.erase(this->recentKeys.back());
+            this->recentKeys.pop_back();
+        }
+
+        Entry& entry = this->entries[key];
+        entry.colors.resize(this->valueCount > 0 ? this->valueCount : 1);
+        this->recentKeys.push_front(key);
+        entry.recentPosition = this->recentKeys.begin();
+
+        return &entry.colors[0];
+    }
+
+    this->recentKeys.splice(this->recentKeys.begin(), this->recentKeys, found->second.recentPosition);
+
+    return &found->second.colors[0];
+}
+
+bool ShadingCache::blend(unsigned long keyA, unsigned long keyB, float weightB, float* colors) {
+    const float* colorsA = this->find(keyA);
+    const float* colorsB = this->find(keyB);
+    if (colorsA == NULL || colorsB == NULL) return false;
+
+    float weightA = 1.f - weightB;
+    for (unsigned int iter = 0; iter < this->valueCount; iter++)
+        colors[iter] = weightA * colorsA[iter] + weightB * colorsB[iter];
+
+    return true;
+}
+
+void ShadingCache::clear() {
+    this->entries.clear();
+    this->recentKeys.clear();
+}
+
+unsigned int ShadingCache::getEntryCount() const {
+    return this->entries.size();
+}
+
+size_t ShadingCache::getByteCount() const {
+    return this->entries.size() * this->valueCount * sizeof(float);
+}
+
+void ShadingCache::getRotationKeys(float angle, unsigned int steps,
+    unsigned long& keyA, unsigned long& keyB, float& weightB)
+{
+    float turns = angle / (2.f * M_PI);
+    turns -= floor(turns);
+
+    float position = turns * (float)steps;
+    if (position >= (float)steps) position = 0.f;
+
+    keyA = (unsigned long)position;
+
+    keyB = (keyA + 1) % steps;
+    weightB = position - (float)keyA;
+    if (weightB < 0.f) weightB = 0.f;
+    if (weightB > 1.f) weightB = 1.f;
+}
+
+float ShadingCache::getRotationAngle(unsigned long key, unsigned int steps) {
+    return 2.f * M_PI * (float)key / (float)steps;
+}
@@ -0,0 +1,49 @@
+#ifndef _SHADINGCACHE_H_
+#define _SHADINGCACHE_H_
+
+#include <cstddef>
+#include <list>
+#include <map>
+#include <vector>
+
+/*
+   least recently used cache of shaded color buffers, keyed by any lighting state hash
+   entries are evicted once the cache grows beyond its byte budget, but two buffers always fit
+   so a pair of neighbouring states can be blended
+*/
+class ShadingCache {
+    struct Entry {
+        std::vector<float> colors;
+        std::list<unsigned long>::iterator recentPosition;
+    };
+
+    std::map<unsigned long, Entry> entries;
+    std::list<unsigned long> recentKeys;
+
+    unsigned int valueCount;
+    size_t byteBudget;
+
+public:
+    ShadingCache(unsigned int valueCount, size_t byteBudget);
+
+  // NULL if the key is not cached, otherwise marks the entry as most recently used
+    const float* find(unsigned long key);
+
+  // buffer for the caller to fill, replacing any previous entry with the same key
+    float* insert(unsigned long key);
+
+  // linear blend of two cached buffers, returns false if either is missing
+    bool blend(unsigned long keyA, unsigned long keyB, float weightB, float* colors);
+
+    void clear();
+
+    unsigned int getEntryCount() const;
+    size_t getByteCount() const;
+
+  // neighbouring keys of an angle quantised into steps per full turn, and the blend weight of the second
+    static void getRotationKeys(float angle, unsigned int steps,
+        unsigned long& keyA, unsigned long& keyB, float& weightB);
+    static float getRotationAngle(unsigned long key, unsigned int steps);
+};
+
+#endif
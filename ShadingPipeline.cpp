@@ -0,0 +1,111 @@
+#include "ShadingPipeline.h"
+
+static const unsigned int FRESH_BIT = 4;
+static const unsigned int INDEX_MASK = 3;
+
+// atomic read, there is no plain __sync load
+static unsigned int loadIndex(volatile unsigned int* target) {
+    return __sync_fetch_and_or(target, 0);
+}
+
+// full-barrier exchange, built from compare and swap since __sync_lock_test_and_set only acquires
+static unsigned int exchangeIndex(volatile unsigned int* target, unsigned int value) {
+    unsigned int previous = loadIndex(target);
+
+    while (true) {
+        unsigned int current = __sync_val_compare_and_swap(target, previous, value);
+        if (current == previous) return previous;
+        previous = current;
+    }
+}
+
+void* runShadingPipeline(void* input) {
+    ShadingPipeline* pipeline = (ShadingPipeline*)input;
+    unsigned int shadedGeneration = 0;
+
+    while (true) {
+        pthread_mutex_lock(&pipeline->requestMutex);
+        while (!pipeline->stopping && pipeline->requestGeneration == shadedGeneration)
+            pthread_cond_wait(&pipeline->requestCondition, &pipeline->requestMutex);
+
+        bool stopping = pipeline->stopping;
+        float angle = pipeline->requestedAngle;
+        shadedGeneration = pipeline->requestGeneration;
+        pthread_mutex_unlock(&pipeline->requestMutex);
+
+        if (stopping) break;
+
+        pipeline->subroutine(pipeline->context, angle, pipeline->buffers[pipeline->backIndex]);
+
+      // publish the finished buffer and take back whichever buffer was shared
+        pipeline->backIndex = exchangeIndex(&pipeline->sharedIndex, pipeline->backIndex | FRESH_BIT) & INDEX_MASK;
+    }
+
+    return NULL;
+}
+
+ShadingPipeline::ShadingPipeline(unsigned int valueCount, ShadingSubroutine subroutine, void* context):
+    subroutine(subroutine),
+    context(context),
+    backIndex(0),
+    frontIndex(1),
+    sharedIndex(2),
+    requestedAngle(0.f),
+    requestGeneration(0),
+    running(false),
+    stopping(false)
+{
+    for (int buffer = 0; buffer < 3; buffer++) {
+        this->buffers[buffer] = new float[valueCount];
+        for (unsigned int value = 0; value < valueCount; value++) this->buffers[buffer][value] = 0.f;
+    }
+
+    pthread_mutex_init(&this->requestMutex, NULL);
+    pthread_cond_init(&this->requestCondition, NULL);
+}
+
+ShadingPipeline::~ShadingPipeline() {
+    this->stop();
+
+    pthread_mutex_destroy(&this->requestMutex);
+    pthread_cond_destroy(&this->requestCondition);
+
+    for (int buffer = 0; buffer < 3; buffer++) delete[] this->buffers[buffer];
+}
+
+void ShadingPipeline::start(float angle) {
+    if (this->running) return;
+
+    this->subroutine(this->context, angle, this->buffers[this->frontIndex]);
+
+    this->stopping = false;
+    this->running = true;
+    pthread_create(&this->thread, NULL, runShadingPipeline, (void*)this);
+}
+
+void ShadingPipeline::stop() {
+    if (!this->running) return;
+
+    pthread_mutex_lock(&this->requestMutex);
+    this->stopping = true;
+    pthread_cond_signal(&this->requestCondition);
+    pthread_mutex_unlock(&this->requestMutex);
+
+    pthread_join(this->thread, NULL);
+    this->running = false;
+}
+
+void ShadingPipeline::request(float angle) {
+    pthread_mutex_lock(&this->requestMutex);
+    this->requestedAngle = angle;
+    this->requestGeneration++;
+    pthread_cond_signal(&this->requestCondition);
+    pthread_mutex_unlock(&this->requestMutex);
+}
+
+const float* ShadingPipeline::acquire() {
+    if (loadIndex(&this->sharedIndex) & FRESH_BIT)
+        this->frontIndex = exchangeIndex(&this->sharedIndex, this->frontIndex) & INDEX_MASK;
+
+    return this->buffers[this->frontIndex];
+}
@@ -0,0 +1,59 @@
+#ifndef _SHADINGPIPELINE_H_
+#define _SHADINGPIPELINE_H_
+
+#include <pthread.h>
+
+/*
+   runs shading on a worker thread ahead of drawing, into a lock-free triple buffer of color arrays:
+    -the worker owns one buffer and shades into it
+    -one buffer is shared, holding the latest complete colors
+    -the render loop owns one buffer and draws from it
+   finished and drawn buffers are swapped with the shared one through an atomic exchange (GCC __sync builtins),
+   so neither side ever waits for the other, and drawing always uses the newest complete colors
+*/
+class ShadingPipeline {
+public:
+  // shades all colors for an angle, called from the worker thread only (and once by start)
+    typedef void (*ShadingSubroutine)(void* context, float angle, float* colors);
+
+private:
+    ShadingSubroutine subroutine;
+    void* context;
+
+    float* buffers[3];
+    unsigned int backIndex;
+    unsigned int frontIndex;
+
+  // index of the shared buffer, with FRESH_BIT set while it has not been picked up by the render loop
+    volatile unsigned int sharedIndex;
+
+  // the worker sleeps until a new angle is requested, only this hand-off is locked
+    pthread_t thread;
+    pthread_mutex_t requestMutex;
+    pthread_cond_t requestCondition;
+    float requestedAngle;
+    unsigned int requestGeneration;
+    bool running;
+    bool stopping;
+
+    friend void* runShadingPipeline(void* input);
+
+    ShadingPipeline(const ShadingPipeline&);
+    ShadingPipeline& operator=(const ShadingPipeline&);
+
+public:
+    ShadingPipeline(unsigned int valueCount, ShadingSubroutine subroutine, void* context);
+    ~ShadingPipeline();
+
+  // shades the first colors on the calling thread, then starts the worker
+    void start(float angle);
+    void stop();
+
+  // asks the worker to shade this angle next, replacing any request it has not started yet
+    void request(float angle);
+
+  // newest complete colors, valid until the next call
+    const float* acquire();
+};
+
+#endif
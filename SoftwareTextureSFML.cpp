@@ -3,11 +3,16 @@
 SoftwareTextureSFML::SoftwareTextureSFML() {
 }
 
-// might want to add loading function for post-constructor calling
-
 SoftwareTextureSFML::SoftwareTextureSFML(const std::string& filePath) {
-    this->image.loadFromFile(filePath);
-    this->texture.loadFromImage(image);
+    this->loadFromFile(filePath);
+}
+
+bool SoftwareTextureSFML::loadFromFile(const std::string& filePath) {
+    return this->image.loadFromFile(filePath);
+}
+
+bool SoftwareTextureSFML::upload() {
+    return this->texture.loadFromImage(this->image);
 }
 
 const sf::Texture* SoftwareTextureSFML::getTexturePointer() const {
@@ -9,6 +9,7 @@
 #include <SFML/System/Vector2.hpp>
 #include <SFML/System/Vector3.hpp>
 
+// texels are decoded into CPU memory, the GPU texture is only created by upload() once a context exists
 class SoftwareTextureSFML {
     sf::Image image;
     sf::Texture texture;
@@ -17,6 +18,12 @@ public:
     SoftwareTextureSFML();
     SoftwareTextureSFML(const std::string& filePath);
 
+  // decoding needs no OpenGL context, so it can run before the window exists and on any thread
+    bool loadFromFile(const std::string& filePath);
+
+  // needs an active OpenGL context
+    bool upload();
+
     const sf::Texture* getTexturePointer() const;
 
   // should this be a const function?
@@ -3,12 +3,31 @@
 
 #include <SFML/System/Vector3.hpp>
 #include <cmath>
+#include <vector>
 
 // everything must be defined in this header, no cpp file
 // refer to http://stackoverflow.com/questions/1353973/c-template-linking-error for why
 
 template <typename ReturnType> class SphericalFunctionSubroutine;
 
+// precomputed look-up tables of sample directions for a given integration resolution
+// can be kept around and shared by any number of integrals of the same resolution
+class SphericalQuadrature {
+    SphericalQuadrature(const SphericalQuadrature&);
+    SphericalQuadrature& operator=(const SphericalQuadrature&);
+public:
+    unsigned int thetaResolution;
+    unsigned int phiResolution;
+
+    float* sinTheta;
+    float* cosTheta;
+    float* sinPhi;
+    float* cosPhi;
+
+    SphericalQuadrature(unsigned int thetaResolution, unsigned int phiResolution);
+    ~SphericalQuadrature();
+};
+
 // abstract base class for spherical functions
 template <typename ReturnType>
 class SphericalFunction {
@@ -16,6 +35,23 @@ public:
     virtual ReturnType getValue(const sf::Vector3<float>& v) = 0;
     ReturnType operator()(const sf::Vector3f&);
     ReturnType integrate(unsigned int thetaResolution, unsigned int phiResolution);
+    ReturnType integrate(const SphericalQuadrature& quadrature);
+
+  // refines a thetaResolution x phiResolution grid of patches until the tolerance is met
+  // or patches are maximumDepth subdivisions deep, and reports the estimated absolute error
+    ReturnType integrateAdaptive(float tolerance, float& errorEstimate,
+        unsigned int thetaResolution = 8, unsigned int phiResolution = 16, unsigned int maximumDepth = 4);
+};
+
+// patch of the sphere in (biased theta, phi) space, along with the value at its center
+template <typename ReturnType>
+struct SphericalPatch {
+    float u;
+    float uSize;
+    float phi;
+    float phiSize;
+    unsigned int depth;
+    ReturnType center;
 };
 
 // spherical function based on user-provided function call
@@ -65,50 +101,78 @@ ReturnType SphericalFunction<ReturnType>::operator()(const sf::Vector3f& v) {
    Note: optimization replaces sin/cos with precomputed look-ups
 */
 
-template <typename ReturnType>
-ReturnType SphericalFunction<ReturnType>::integrate(unsigned int thetaResolution,
-    unsigned int phiResolution)
+// spherical quadrature methods, inline since there is no cpp file
+
+inline SphericalQuadrature::SphericalQuadrature(unsigned int thetaResolution, unsigned int phiResolution):
+    thetaResolution(thetaResolution),
+    phiResolution(phiResolution)
 {
     float thetaDifferential = M_PI / (float)thetaResolution;
     float phiDifferential = 2.f * M_PI / (float)phiResolution;
 
-    ReturnType integral;
-    integral *= 0.f;
-
   /*
      NOTE: using a look-up table for sin(theta), cos(theta), sin(phi), cos(phi)
            provides a significant performance improvement; using the cartesian forms
            of spherical harmonic functions will forgo need to use sin/cos (x, x*y, etc.).
   */
 
-    float* sinTheta = new float[thetaResolution];
-    float* cosTheta = new float[thetaResolution];
-    float* sinPhi = new float[phiResolution];
-    float* cosPhi = new float[phiResolution];
+    this->sinTheta = new float[thetaResolution];
+    this->cosTheta = new float[thetaResolution];
+    this->sinPhi = new float[phiResolution];
+    this->cosPhi = new float[phiResolution];
 
   // precomputed look-up tables for cos(theta) and sin(theta)
-    for (int thetaIter = 0; thetaIter < thetaResolution; thetaIter++) {
+    for (unsigned int thetaIter = 0; thetaIter < thetaResolution; thetaIter++) {
         float theta = thetaIter * thetaDifferential + 0.5f * thetaDifferential;
         theta = 2.f * acos(sqrt(1.f - (theta / M_PI))); // bias theta away from poles
-        sinTheta[thetaIter] = sin(theta);
-        cosTheta[thetaIter] = cos(theta);
+        this->sinTheta[thetaIter] = sin(theta);
+        this->cosTheta[thetaIter] = cos(theta);
     }
 
   // precomputed look-up tables for cos(phi) and sin(phi)
-    for (int phiIter = 0; phiIter < phiResolution; phiIter++) {
+    for (unsigned int phiIter = 0; phiIter < phiResolution; phiIter++) {
         float phi = phiIter * phiDifferential + 0.5f * phiDifferential;
-        sinPhi[phiIter] = sin(phi);
-        cosPhi[phiIter] = cos(phi);
+        this->sinPhi[phiIter] = sin(phi);
+        this->cosPhi[phiIter] = cos(phi);
     }
+}
+
+inline SphericalQuadrature::~SphericalQuadrature() {
+    delete[] this->sinTheta;
+    delete[] this->cosTheta;
+    delete[] this->sinPhi;
+    delete[] this->cosPhi;
+}
+
+template <typename ReturnType>
+ReturnType SphericalFunction<ReturnType>::integrate(unsigned int thetaResolution,
+    unsigned int phiResolution)
+{
+    SphericalQuadrature quadrature(thetaResolution, phiResolution);
+    return this->integrate(quadrature);
+}
+
+template <typename ReturnType>
+ReturnType SphericalFunction<ReturnType>::integrate(const SphericalQuadrature& quadrature) {
+    unsigned int thetaResolution = quadrature.thetaResolution;
+    unsigned int phiResolution = quadrature.phiResolution;
+
+    const float* sinTheta = quadrature.sinTheta;
+    const float* cosTheta = quadrature.cosTheta;
+    const float* sinPhi = quadrature.sinPhi;
+    const float* cosPhi = quadrature.cosPhi;
+
+    ReturnType integral;
+    integral *= 0.f;
 
   // need to compute integral of f(theta,phi) * sin(theta) over domain [0,pi]x[0,2pi]
   // to get average radius, divide by 4pi, since it is the integral of sin(theta) on same domain
 
-    for (int thetaIter = 0; thetaIter < thetaResolution; thetaIter++) {
+    for (unsigned int thetaIter = 0; thetaIter < thetaResolution; thetaIter++) {
         //float theta = thetaIter * thetaDifferential + 0.5f * thetaDifferential;
         //theta = 2.f * acos(sqrt(1.f - (theta / M_PI)));
 
-        for (int phiIter = 0; phiIter < phiResolution; phiIter++) {
+        for (unsigned int phiIter = 0; phiIter < phiResolution; phiIter++) {
             //float phi = phiIter * phiDifferential + 0.5f * phiDifferential;
 
             sf::Vector3f sampleVector;
@@ -132,10 +196,115 @@ ReturnType SphericalFunction<ReturnType>::integrate(unsigned int thetaResolution
     float domain = 4.f * M_PI; // for biased theta
     integral *= domain;
 
-    delete[] sinTheta;
-    delete[] cosTheta;
-    delete[] sinPhi;
-    delete[] cosPhi;
+    return integral;
+}
+
+// direction for biased theta parameter u in [0,1] (cos(theta) = 1 - 2u) and phi in [0,2pi]
+inline sf::Vector3f sphericalDirection(float u, float phi) {
+    float cosTheta = 1.f - 2.f * u;
+    float sinThetaSquared = 1.f - cosTheta * cosTheta;
+    float sinTheta = (sinThetaSquared > 0.f) ? sqrt(sinThetaSquared) : 0.f;
+
+    return sf::Vector3f(sinTheta * sin(phi), cosTheta, sinTheta * cos(phi));
+}
+
+// largest absolute component of a spherical function value, used for error estimates
+inline float sphericalFunctionMagnitude(float value) {
+    return fabs(value);
+}
+
+inline float sphericalFunctionMagnitude(const sf::Vector3f& value) {
+    float magnitude = fabs(value.x);
+    if (fabs(value.y) > magnitude) magnitude = fabs(value.y);
+    if (fabs(value.z) > magnitude) magnitude = fabs(value.z);
+    return magnitude;
+}
+
+/*
+   every patch is compared against its 3x3 subdivision, which reuses the patch center as its middle sample
+   patches whose estimates disagree by more than their share of the tolerance (by area) are subdivided,
+   so effort goes to regions where the function has detail and smooth regions stop early
+*/
+template <typename ReturnType>
+ReturnType SphericalFunction<ReturnType>::integrateAdaptive(float tolerance, float& errorEstimate,
+    unsigned int thetaResolution, unsigned int phiResolution, unsigned int maximumDepth)
+{
+    ReturnType integral;
+    integral *= 0.f;
+
+    errorEstimate = 0.f;
+
+    std::vector<SphericalPatch<ReturnType> > patches;
+
+    float uDifferential = 1.f / (float)thetaResolution;
+    float phiDifferential = 2.f * M_PI / (float)phiResolution;
+
+    for (unsigned int thetaIter = 0; thetaIter < thetaResolution; thetaIter++) {
+        for (unsigned int phiIter = 0; phiIter < phiResolution; phiIter++) {
+            SphericalPatch<ReturnType> patch;
+            patch.u = thetaIter * uDifferential;
+            patch.uSize = uDifferential;
+            patch.phi = phiIter * phiDifferential;
+            patch.phiSize = phiDifferential;
+            patch.depth = 0;
+            patch.center = this->getValue(sphericalDirection(patch.u + 0.5f * patch.uSize,
+                patch.phi + 0.5f * patch.phiSize));
+
+            patches.push_back(patch);
+        }
+    }
+
+    while (!patches.empty()) {
+        SphericalPatch<ReturnType> patch = patches.back();
+        patches.pop_back();
+
+      // biased theta makes area proportional to the patch size in (u, phi)
+        float area = 2.f * patch.uSize * patch.phiSize;
+
+        ReturnType coarse = patch.center;
+        coarse *= area;
+
+        SphericalPatch<ReturnType> children[9];
+        ReturnType fine;
+        fine *= 0.f;
+
+        for (int child = 0; child < 9; child++) {
+            int row = child / 3;
+            int column = child % 3;
+
+            children[child].uSize = patch.uSize / 3.f;
+            children[child].phiSize = patch.phiSize / 3.f;
+            children[child].u = patch.u + row * children[child].uSize;
+            children[child].phi = patch.phi + column * children[child].phiSize;
+            children[child].depth = patch.depth + 1;
+
+            if (child == 4) {
+                children[child].center = patch.center;
+            }
+            else {
+                children[child].center = this->getValue(sphericalDirection(
+                    children[child].u + 0.5f * children[child].uSize,
+                    children[child].phi + 0.5f * children[child].phiSize));
+            }
+
+            fine += children[child].center;
+        }
+
+        fine *= area / 9.f;
+
+        ReturnType difference = coarse;
+        difference *= -1.f;
+        difference += fine;
+        float error = sphericalFunctionMagnitude(difference);
+
+        if (error <= tolerance * area / (4.f * M_PI) || patch.depth >= maximumDepth) {
+            integral += fine;
+            errorEstimate += error;
+        }
+        else {
+            for (int child = 0; child < 9; child++) patches.push_back(children[child]);
+        }
+    }
 
     return integral;
 }
@@ -0,0 +1,167 @@
+#include "SphericalHarmonics.h"
+
+#if defined(__AVX512F__) || defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+// harmonic band 0
+
+float HarmonicBasis0(const sf::Vector3<float>& vector) {
+    return HARMONIC_COEFFICIENT0;
+}
+
+// harmonic band 1
+
+float HarmonicBasis1(const sf::Vector3f& vector) {
+    return HARMONIC_COEFFICIENT1 * vector.y;
+}
+
+float HarmonicBasis2(const sf::Vector3f& vector) {
+    return HARMONIC_COEFFICIENT1 * vector.z;
+}
+
+float HarmonicBasis3(const sf::Vector3f& vector) {
+    return HARMONIC_COEFFICIENT1 * vector.x;
+}
+
+// harmonic band 2
+
+float HarmonicBasis4(const sf::Vector3f& vector) {
+    return HARMONIC_COEFFICIENT2 * vector.x * vector.y;
+}
+
+float HarmonicBasis5(const sf::Vector3f& vector) {
+    return HARMONIC_COEFFICIENT2 * vector.y * vector.z;
+}
+
+float HarmonicBasis6(const sf::Vector3f& vector) {
+    return HARMONIC_COEFFICIENT3 * -(vector.x * vector.x + vector.y * vector.y - 2.f * vector.z * vector.z);
+}
+
+float HarmonicBasis7(const sf::Vector3f& vector) {
+    return HARMONIC_COEFFICIENT2 * vector.z * vector.x;
+}
+
+float HarmonicBasis8(const sf::Vector3f& vector) {
+    return HARMONIC_COEFFICIENT2 * 0.5f * (vector.x * vector.x - vector.y * vector.y);
+}
+
+// global spherical functions based on spherical harmonics
+
+SphericalFunctionSubroutine<float> SphericalHarmonics[BASIS_FUNCTION_COUNT] =
+{
+    SphericalFunctionSubroutine<float>(HarmonicBasis0),
+    SphericalFunctionSubroutine<float>(HarmonicBasis1),
+    SphericalFunctionSubroutine<float>(HarmonicBasis2),
+    SphericalFunctionSubroutine<float>(HarmonicBasis3),
+    SphericalFunctionSubroutine<float>(HarmonicBasis4),
+    SphericalFunctionSubroutine<float>(HarmonicBasis5),
+    SphericalFunctionSubroutine<float>(HarmonicBasis6),
+    SphericalFunctionSubroutine<float>(HarmonicBasis7),
+    SphericalFunctionSubroutine<float>(HarmonicBasis8)
+};
+
+/*
+   basis 6 is written as c3 * ((zz + zz) - (xx + yy)) and basis 8 as (c2 / 2) * (xx - yy) in every path,
+   multiplies and adds are kept separate (no fused multiply-add) so the vector and scalar paths agree
+*/
+void calculateHarmonicBasisBlock(unsigned int count, const float* x, const float* y, const float* z,
+    float* basisValues, unsigned int basisStride)
+{
+    const float coefficient0 = HARMONIC_COEFFICIENT0;
+    const float coefficient1 = HARMONIC_COEFFICIENT1;
+    const float coefficient2 = HARMONIC_COEFFICIENT2;
+    const float coefficient3 = HARMONIC_COEFFICIENT3;
+    const float halfCoefficient2 = 0.5f * coefficient2;
+
+    float* basis0 = basisValues + 0 * basisStride;
+    float* basis1 = basisValues + 1 * basisStride;
+    float* basis2 = basisValues + 2 * basisStride;
+    float* basis3 = basisValues + 3 * basisStride;
+    float* basis4 = basisValues + 4 * basisStride;
+    float* basis5 = basisValues + 5 * basisStride;
+    float* basis6 = basisValues + 6 * basisStride;
+    float* basis7 = basisValues + 7 * basisStride;
+    float* basis8 = basisValues + 8 * basisStride;
+
+    unsigned int iter = 0;
+
+#if defined(__AVX512F__)
+    {
+        const __m512 c0 = _mm512_set1_ps(coefficient0);
+        const __m512 c1 = _mm512_set1_ps(coefficient1);
+        const __m512 c2 = _mm512_set1_ps(coefficient2);
+        const __m512 c3 = _mm512_set1_ps(coefficient3);
+        const __m512 c2Half = _mm512_set1_ps(halfCoefficient2);
+
+        for (; iter + 16 <= count; iter += 16) {
+            __m512 vx = _mm512_loadu_ps(x + iter);
+            __m512 vy = _mm512_loadu_ps(y + iter);
+            __m512 vz = _mm512_loadu_ps(z + iter);
+
+            __m512 xx = _mm512_mul_ps(vx, vx);
+            __m512 yy = _mm512_mul_ps(vy, vy);
+            __m512 zz = _mm512_mul_ps(vz, vz);
+
+            _mm512_storeu_ps(basis0 + iter, c0);
+            _mm512_storeu_ps(basis1 + iter, _mm512_mul_ps(c1, vy));
+            _mm512_storeu_ps(basis2 + iter, _mm512_mul_ps(c1, vz));
+            _mm512_storeu_ps(basis3 + iter, _mm512_mul_ps(c1, vx));
+            _mm512_storeu_ps(basis4 + iter, _mm512_mul_ps(c2, _mm512_mul_ps(vx, vy)));
+            _mm512_storeu_ps(basis5 + iter, _mm512_mul_ps(c2, _mm512_mul_ps(vy, vz)));
+            _mm512_storeu_ps(basis6 + iter, _mm512_mul_ps(c3,
+                _mm512_sub_ps(_mm512_add_ps(zz, zz), _mm512_add_ps(xx, yy))));
+            _mm512_storeu_ps(basis7 + iter, _mm512_mul_ps(c2, _mm512_mul_ps(vz, vx)));
+            _mm512_storeu_ps(basis8 + iter, _mm512_mul_ps(c2Half, _mm512_sub_ps(xx, yy)));
+        }
+    }
+#endif
+
+#if defined(__AVX2__)
+    {
+        const __m256 c0 = _mm256_set1_ps(coefficient0);
+        const __m256 c1 = _mm256_set1_ps(coefficient1);
+        const __m256 c2 = _mm256_set1_ps(coefficient2);
+        const __m256 c3 = _mm256_set1_ps(coefficient3);
+        const __m256 c2Half = _mm256_set1_ps(halfCoefficient2);
+
+        for (; iter + 8 <= count; iter += 8) {
+            __m256 vx = _mm256_loadu_ps(x + iter);
+            __m256 vy = _mm256_loadu_ps(y + iter);
+            __m256 vz = _mm256_loadu_ps(z + iter);
+
+            __m256 xx = _mm256_mul_ps(vx, vx);
+            __m256 yy = _mm256_mul_ps(vy, vy);
+            __m256 zz = _mm256_mul_ps(vz, vz);
+
+            _mm256_storeu_ps(basis0 + iter, c0);
+            _mm256_storeu_ps(basis1 + iter, _mm256_mul_ps(c1, vy));
+            _mm256_storeu_ps(basis2 + iter, _mm256_mul_ps(c1, vz));
+            _mm256_storeu_ps(basis3 + iter, _mm256_mul_ps(c1, vx));
+            _mm256_storeu_ps(basis4 + iter, _mm256_mul_ps(c2, _mm256_mul_ps(vx, vy)));
+            _mm256_storeu_ps(basis5 + iter, _mm256_mul_ps(c2, _mm256_mul_ps(vy, vz)));
+            _mm256_storeu_ps(basis6 + iter, _mm256_mul_ps(c3,
+                _mm256_sub_ps(_mm256_add_ps(zz, zz), _mm256_add_ps(xx, yy))));
+            _mm256_storeu_ps(basis7 + iter, _mm256_mul_ps(c2, _mm256_mul_ps(vz, vx)));
+            _mm256_storeu_ps(basis8 + iter, _mm256_mul_ps(c2Half, _mm256_sub_ps(xx, yy)));
+        }
+    }
+#endif
+
+  // remainder, or everything without vector support
+    for (; iter < count; iter++) {
+        float xx = x[iter] * x[iter];
+        float yy = y[iter] * y[iter];
+        float zz = z[iter] * z[iter];
+
+        basis0[iter] = coefficient0;
+        basis1[iter] = coefficient1 * y[iter];
+        basis2[iter] = coefficient1 * z[iter];
+        basis3[iter] = coefficient1 * x[iter];
+        basis4[iter] = coefficient2 * (x[iter] * y[iter]);
+        basis5[iter] = coefficient2 * (y[iter] * z[iter]);
+        basis6[iter] = coefficient3 * ((zz + zz) - (xx + yy));
+        basis7[iter] = coefficient2 * (z[iter] * x[iter]);
+        basis8[iter] = halfCoefficient2 * (xx - yy);
+    }
+}
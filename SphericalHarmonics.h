@@ -1,6 +1,8 @@
-#include "SphericalFunction.h"
+#ifndef _SPHERICALHARMONICS_H_
+#define _SPHERICALHARMONICS_H_
 
-#define BASIS_FUNCTION_COUNT 9
+#include "HarmonicBasisCount.h"
+#include "SphericalFunction.h"
 
 // sqrt(1/pi)/2
 #define HARMONIC_COEFFICIENT0 0.28209479177387814347403972578039
@@ -14,59 +16,33 @@
 // sqrt(5/pi)/4
 #define HARMONIC_COEFFICIENT3 0.31539156525252000603089369029571
 
-// harmonic band 0
-
-float HarmonicBasis0(const sf::Vector3<float>& vector) {
-    return HARMONIC_COEFFICIENT0;
-}
-
-// harmonic band 1
-
-float HarmonicBasis1(const sf::Vector3f& vector) {
-    return HARMONIC_COEFFICIENT1 * vector.y;
-}
+// harmonic basis functions, defined in SphericalHarmonics.cpp so several files can share them
 
-float HarmonicBasis2(const sf::Vector3f& vector) {
-    return HARMONIC_COEFFICIENT1 * vector.z;
-}
+float HarmonicBasis0(const sf::Vector3<float>& vector);
 
-float HarmonicBasis3(const sf::Vector3f& vector) {
-    return HARMONIC_COEFFICIENT1 * vector.x;
-}
+float HarmonicBasis1(const sf::Vector3f& vector);
+float HarmonicBasis2(const sf::Vector3f& vector);
+float HarmonicBasis3(const sf::Vector3f& vector);
 
-// harmonic band 2
+float HarmonicBasis4(const sf::Vector3f& vector);
+float HarmonicBasis5(const sf::Vector3f& vector);
+float HarmonicBasis6(const sf::Vector3f& vector);
+float HarmonicBasis7(const sf::Vector3f& vector);
+float HarmonicBasis8(const sf::Vector3f& vector);
 
-float HarmonicBasis4(const sf::Vector3f& vector) {
-    return HARMONIC_COEFFICIENT2 * vector.x * vector.y;
-}
-
-float HarmonicBasis5(const sf::Vector3f& vector) {
-    return HARMONIC_COEFFICIENT2 * vector.y * vector.z;
-}
-
-float HarmonicBasis6(const sf::Vector3f& vector) {
-    return HARMONIC_COEFFICIENT3 * -(vector.x * vector.x + vector.y * vector.y - 2.f * vector.z * vector.z);
-}
-
-float HarmonicBasis7(const sf::Vector3f& vector) {
-    return HARMONIC_COEFFICIENT2 * vector.z * vector.x;
-}
-
-float HarmonicBasis8(const sf::Vector3f& vector) {
-    return HARMONIC_COEFFICIENT2 * 0.5f * (vector.x * vector.x - vector.y * vector.y);
-}
+/*
+   every basis function for a block of directions given as separate x, y and z arrays (structure of arrays),
+   with the shared products (x*y, z*z, ...) formed once per direction
+   basis b of direction i is written to basisValues[basis * basisStride + i]
+   runs at AVX-512 or AVX2 width when the compiler targets them (see SIMDFLAGS in the Makefile),
+   every path performs the same float operations (built without contraction into fused multiply-adds),
+   so the values do not depend on the instruction set
+*/
+void calculateHarmonicBasisBlock(unsigned int count, const float* x, const float* y, const float* z,
+    float* basisValues, unsigned int basisStride);
 
 // global spherical functions based on spherical harmonics
 
-SphericalFunctionSubroutine<float> SphericalHarmonics[BASIS_FUNCTION_COUNT] =
-{
-    SphericalFunctionSubroutine<float>(HarmonicBasis0),
-    SphericalFunctionSubroutine<float>(HarmonicBasis1),
-    SphericalFunctionSubroutine<float>(HarmonicBasis2),
-    SphericalFunctionSubroutine<float>(HarmonicBasis3),
-    SphericalFunctionSubroutine<float>(HarmonicBasis4),
-    SphericalFunctionSubroutine<float>(HarmonicBasis5),
-    SphericalFunctionSubroutine<float>(HarmonicBasis6),
-    SphericalFunctionSubroutine<float>(HarmonicBasis7),
-    SphericalFunctionSubroutine<float>(HarmonicBasis8)
-};
+extern SphericalFunctionSubroutine<float> SphericalHarmonics[BASIS_FUNCTION_COUNT];
+
+#endif
@@ -0,0 +1,128 @@
+#include "TransferTable.h"
+#include "VisibilityTransfer.h"
+#include "SphericalHarmonics.h"
+
+#include <cmath>
+
+TransferTable::TransferTable():
+    resolution(0),
+    coefficients(NULL)
+{
+}
+
+TransferTable::~TransferTable() {
+    delete[] this->coefficients;
+}
+
+void TransferTable::build(unsigned int resolution, unsigned int thetaResolution, unsigned int phiResolution,
+    int threadCount)
+{
+    if (resolution < 2) resolution = 2;
+
+    delete[] this->coefficients;
+    this->resolution = resolution;
+    this->coefficients = new float[BASIS_FUNCTION_COUNT * resolution * resolution];
+
+    float* directions = new float[3 * resolution * resolution];
+
+    for (unsigned int row = 0; row < resolution; row++) {
+        for (unsigned int column = 0; column < resolution; column++) {
+            sf::Vector2f texCoords((float)column / (resolution - 1), (float)row / (resolution - 1));
+            sf::Vector3f direction = TransferTable::decodeOctahedral(texCoords);
+
+            unsigned int texel = resolution * row + column;
+            directions[3 * texel + 0] = direction.x;
+            directions[3 * texel + 1] = direction.y;
+            directions[3 * texel + 2] = direction.z;
+        }
+    }
+
+    calculateVisibilityCoefficients(directions, resolution * resolution, this->coefficients,
+        thetaResolution, phiResolution, threadCount);
+
+    delete[] directions;
+}
+
+void TransferTable::lookup(const sf::Vector3f& normal, float* coefficients) const {
+    sf::Vector2f texCoords = TransferTable::encodeOctahedral(normal);
+
+    float imageX = texCoords.x * (float)(this->resolution - 1);
+    float imageY = texCoords.y * (float)(this->resolution - 1);
+
+    int column = (int)imageX;
+    int row = (int)imageY;
+    if (column < 0) column = 0;
+    if (row < 0) row = 0;
+    if (column > (int)this->resolution - 2) column = this->resolution - 2;
+    if (row > (int)this->resolution - 2) row = this->resolution - 2;
+
+    float blendX = imageX - (float)column;
+    float blendY = imageY - (float)row;
+
+    const float* texel00 = &this->coefficients[BASIS_FUNCTION_COUNT * (this->resolution * row + column)];
+    const float* texel01 = texel00 + BASIS_FUNCTION_COUNT;
+    const float* texel10 = texel00 + BASIS_FUNCTION_COUNT * this->resolution;
+    const float* texel11 = texel10 + BASIS_FUNCTION_COUNT;
+
+    float weight00 = (1.f - blendX) * (1.f - blendY);
+    float weight01 = blendX * (1.f - blendY);
+    float weight10 = (1.f - blendX) * blendY;
+    float weight11 = blendX * blendY;
+
+    for (int basis = 0; basis < BASIS_FUNCTION_COUNT; basis++) {
+        coefficients[basis] = weight00 * texel00[basis] + weight01 * texel01[basis] +
+            weight10 * texel10[basis] + weight11 * texel11[basis];
+    }
+}
+
+void TransferTable::calculateCoefficients(const float* normalPointer, unsigned int normalCount,
+    float* coefficientPointer) const
+{
+    for (unsigned int iter = 0; iter < normalCount; iter++) {
+        sf::Vector3f normal;
+        normal.x = normalPointer[3 * iter + 0];
+        normal.y = normalPointer[3 * iter + 1];
+        normal.z = normalPointer[3 * iter + 2];
+
+        this->lookup(normal, &coefficientPointer[BASIS_FUNCTION_COUNT * iter]);
+    }
+}
+
+unsigned int TransferTable::getResolution() const {
+    return this->resolution;
+}
+
+// octahedral mapping folds the lower (negative Z) hemisphere over the diagonals of the square
+
+sf::Vector2f TransferTable::encodeOctahedral(const sf::Vector3f& direction) {
+    float sum = fabs(direction.x) + fabs(direction.y) + fabs(direction.z);
+    if (sum <= 0.f) return sf::Vector2f(0.5f, 0.5f);
+
+    float x = direction.x / sum;
+    float y = direction.y / sum;
+
+    if (direction.z < 0.f) {
+        float foldedX = (1.f - fabs(y)) * (x >= 0.f ? 1.f : -1.f);
+        float foldedY = (1.f - fabs(x)) * (y >= 0.f ? 1.f : -1.f);
+        x = foldedX;
+        y = foldedY;
+    }
+
+    return sf::Vector2f(0.5f * x + 0.5f, 0.5f * y + 0.5f);
+}
+
+sf::Vector3f TransferTable::decodeOctahedral(const sf::Vector2f& texCoords) {
+    float x = 2.f * texCoords.x - 1.f;
+    float y = 2.f * texCoords.y - 1.f;
+    float z = 1.f - fabs(x) - fabs(y);
+
+    if (z < 0.f) {
+        float unfoldedX = (1.f - fabs(y)) * (x >= 0.f ? 1.f : -1.f);
+        float unfoldedY = (1.f - fabs(x)) * (y >= 0.f ? 1.f : -1.f);
+        x = unfoldedX;
+        y = unfoldedY;
+    }
+
+    float length = sqrt(x * x + y * y + z * z);
+    return sf::Vector3f(x / length, y / length, z / length);
+}
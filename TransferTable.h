@@ -0,0 +1,39 @@
+#ifndef _TRANSFERTABLE_H_
+#define _TRANSFERTABLE_H_
+
+#include <SFML/System/Vector2.hpp>
+#include <SFML/System/Vector3.hpp>
+
+/*
+   visibility transfer of a normal only depends on the normal itself,
+   so it can be baked once over an octahedral grid of directions and looked up per vertex
+   the grid places samples on the corners of resolution x resolution cells over [0,1]x[0,1],
+   which keeps bilinear interpolation inside the octahedral square
+*/
+class TransferTable {
+    unsigned int resolution;
+    float* coefficients;
+
+  // copying would share the table, not supported
+    TransferTable(const TransferTable&);
+    TransferTable& operator=(const TransferTable&);
+
+public:
+    TransferTable();
+    ~TransferTable();
+
+    void build(unsigned int resolution, unsigned int thetaResolution, unsigned int phiResolution, int threadCount);
+
+  // bilinearly interpolated BASIS_FUNCTION_COUNT coefficients for a normal
+    void lookup(const sf::Vector3f& normal, float* coefficients) const;
+
+  // fills BASIS_FUNCTION_COUNT coefficients per normal
+    void calculateCoefficients(const float* normalPointer, unsigned int normalCount, float* coefficientPointer) const;
+
+    unsigned int getResolution() const;
+
+    static sf::Vector2f encodeOctahedral(const sf::Vector3f& direction);
+    static sf::Vector3f decodeOctahedral(const sf::Vector2f& texCoords);
+};
+
+#endif
@@ -0,0 +1,169 @@
+#include "VertexStream.h"
+
+#include <cstdlib>
+#include <cstring>
+
+const size_t VertexStream::ALIGNMENT;
+
+VertexStream::VertexStream():
+    arena(NULL),
+    capacity(0),
+    vertexCount(0),
+    transferStride(0),
+    positions(NULL),
+    normals(NULL),
+    transfer(NULL),
+    colors(NULL)
+{
+}
+
+VertexStream::~VertexStream() {
+    this->release();
+}
+
+// bytes of a plane, rounded up so the next plane stays aligned
+
+size_t VertexStream::getPlaneSize(unsigned int vertexCount, unsigned int stride) {
+    size_t bytes = (size_t)vertexCount * stride * sizeof(float);
+    return (bytes + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+}
+
+bool VertexStream::allocate(unsigned int vertexCount, unsigned int transferStride) {
+    size_t vectorPlane = VertexStream::getPlaneSize(vertexCount, 3);
+    size_t transferPlane = VertexStream::getPlaneSize(vertexCount, transferStride);
+    size_t required = 3 * vectorPlane + transferPlane;
+
+  // malloc only guarantees a small alignment, so over-allocate and remember the original pointer
+    if (required > this->capacity || this->arena == NULL) {
+        this->release();
+
+        this->arena = (char*)malloc(required + ALIGNMENT);
+        if (this->arena == NULL) return false;
+
+        this->capacity = required;
+    }
+
+    char* base = (char*)(((size_t)this->arena + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT);
+
+    this->vertexCount = vertexCount;
+    this->transferStride = transferStride;
+
+    this->positions = (float*)base;
+    this->normals = (float*)(base + vectorPlane);
+    this->colors = (float*)(base + 2 * vectorPlane);
+    this->transfer = (float*)(base + 3 * vectorPlane);
+
+    return true;
+}
+
+void VertexStream::release() {
+    free(this->arena);
+
+    this->arena = NULL;
+    this->capacity = 0;
+    this->vertexCount = 0;
+    this->transferStride = 0;
+    this->positions = NULL;
+    this->normals = NULL;
+    this->transfer = NULL;
+    this->colors = NULL;
+}
+
+void VertexStream::swap(VertexStream& other) {
+    char* arena = this->arena;
+    size_t capacity = this->capacity;
+    unsigned int vertexCount = this->vertexCount;
+    unsigned int transferStride = this->transferStride;
+    float* positions = this->positions;
+    float* normals = this->normals;
+    float* transfer = this->transfer;
+    float* colors = this->colors;
+
+    this->arena = other.arena;
+    this->capacity = other.capacity;
+    this->vertexCount = other.vertexCount;
+    this->transferStride = other.transferStride;
+    this->positions = other.positions;
+    this->normals = other.normals;
+    this->transfer = other.transfer;
+    this->colors = other.colors;
+
+    other.arena = arena;
+    other.capacity = capacity;
+    other.vertexCount = vertexCount;
+    other.transferStride = transferStride;
+    other.positions = positions;
+    other.normals = normals;
+    other.transfer = transfer;
+    other.colors = colors;
+}
+
+bool VertexStream::setTransferStride(unsigned int transferStride) {
+    if (transferStride == this->transferStride) return true;
+
+    VertexStream resized;
+    if (!resized.allocate(this->vertexCount, transferStride)) return false;
+
+    size_t vectorBytes = (size_t)this->vertexCount * 3 * sizeof(float);
+    if (vectorBytes > 0) {
+        memcpy(resized.positions, this->positions, vectorBytes);
+        memcpy(resized.normals, this->normals, vectorBytes);
+        memcpy(resized.colors, this->colors, vectorBytes);
+    }
+
+    unsigned int keptStride = (transferStride < this->transferStride) ? transferStride : this->transferStride;
+    for (unsigned int iter = 0; iter < this->vertexCount; iter++) {
+        for (unsigned int coefficient = 0; coefficient < transferStride; coefficient++) {
+            resized.transfer[transferStride * iter + coefficient] = (coefficient < keptStride) ?
+                this->transfer[this->transferStride * iter + coefficient] : 0.f;
+        }
+    }
+
+    this->swap(resized);
+
+    return true;
+}
+
+float* VertexStream::getPositionPointer() {
+    return this->positions;
+}
+
+float* VertexStream::getNormalPointer() {
+    return this->normals;
+}
+
+float* VertexStream::getTransferPointer() {
+    return this->transfer;
+}
+
+float* VertexStream::getColorPointer() {
+    return this->colors;
+}
+
+const float* VertexStream::getPositionPointer() const {
+    return this->positions;
+}
+
+const float* VertexStream::getNormalPointer() const {
+    return this->normals;
+}
+
+const float* VertexStream::getTransferPointer() const {
+    return this->transfer;
+}
+
+const float* VertexStream::getColorPointer() const {
+    return this->colors;
+}
+
+unsigned int VertexStream::getVertexCount() const {
+    return this->vertexCount;
+}
+
+unsigned int VertexStream::getTransferStride() const {
+    return this->transferStride;
+}
+
+size_t VertexStream::getByteCount() const {
+    return this->capacity;
+}
@@ -0,0 +1,62 @@
+#ifndef _VERTEXSTREAM_H_
+#define _VERTEXSTREAM_H_
+
+#include <cstddef>
+
+/*
+   owns every per-vertex plane of a model in a single allocation:
+    -positions and normals, 3 floats per vertex
+    -transfer coefficients, transferStride floats per vertex
+    -colors, 3 floats per vertex
+   every plane starts on a 64-byte boundary, and the allocation is kept when the stream is reused
+   streams cannot be copied, ownership is moved with swap
+*/
+class VertexStream {
+    char* arena;
+    size_t capacity;
+
+    unsigned int vertexCount;
+    unsigned int transferStride;
+
+    float* positions;
+    float* normals;
+    float* transfer;
+    float* colors;
+
+    VertexStream(const VertexStream&);
+    VertexStream& operator=(const VertexStream&);
+
+public:
+    static const size_t ALIGNMENT = 64;
+
+    VertexStream();
+    ~VertexStream();
+
+  // contents are undefined afterwards, the allocation is only replaced if it is too small
+  // returns false, leaving the stream empty, if the memory cannot be allocated
+    bool allocate(unsigned int vertexCount, unsigned int transferStride);
+    void release();
+    void swap(VertexStream& other);
+
+  // keeps positions, normals and colors, and as many transfer coefficients as still fit
+  // returns false, leaving the stream unchanged, if the resized stream cannot be allocated
+    bool setTransferStride(unsigned int transferStride);
+
+    float* getPositionPointer();
+    float* getNormalPointer();
+    float* getTransferPointer();
+    float* getColorPointer();
+
+    const float* getPositionPointer() const;
+    const float* getNormalPointer() const;
+    const float* getTransferPointer() const;
+    const float* getColorPointer() const;
+
+    unsigned int getVertexCount() const;
+    unsigned int getTransferStride() const;
+    size_t getByteCount() const;
+
+    static size_t getPlaneSize(unsigned int vertexCount, unsigned int stride);
+};
+
+#endif
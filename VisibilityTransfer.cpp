@@ -0,0 +1,145 @@
+#include "VisibilityTransfer.h"
+#include "SphericalHarmonics.h"
+
+#include <map>
+#include <vector>
+
+#include <pthread.h>
+
+/*
+   every normal is integrated over the same sample directions, so the basis values of all samples
+   are evaluated once per thread with the block kernel, leaving a clamped dot product and
+   BASIS_FUNCTION_COUNT dense sums per normal
+*/
+void* calculateVisibilityCoefficientsThreaded(void* input) {
+    CalculateVisibilityCoefficientsParameters* parameters =
+        (CalculateVisibilityCoefficientsParameters*)input;
+
+    SphericalQuadrature quadrature(parameters->thetaResolution, parameters->phiResolution);
+    unsigned int sampleCount = quadrature.thetaResolution * quadrature.phiResolution;
+    if (sampleCount == 0) return NULL;
+
+    std::vector<float> x(sampleCount), y(sampleCount), z(sampleCount);
+    std::vector<float> basisValues(BASIS_FUNCTION_COUNT * sampleCount);
+    std::vector<float> visibility(sampleCount);
+
+    for (unsigned int thetaIter = 0; thetaIter < quadrature.thetaResolution; thetaIter++) {
+        for (unsigned int phiIter = 0; phiIter < quadrature.phiResolution; phiIter++) {
+            unsigned int sample = quadrature.phiResolution * thetaIter + phiIter;
+            x[sample] = quadrature.sinTheta[thetaIter] * quadrature.sinPhi[phiIter];
+            y[sample] = quadrature.cosTheta[thetaIter];
+            z[sample] = quadrature.sinTheta[thetaIter] * quadrature.cosPhi[phiIter];
+        }
+    }
+
+    calculateHarmonicBasisBlock(sampleCount, &x[0], &y[0], &z[0], &basisValues[0], sampleCount);
+
+  // same normalization as SphericalFunction::integrate, for biased theta
+    float average = 1.f / (float)sampleCount;
+    float domain = 4.f * M_PI;
+
+    for (int iter = parameters->startIndex; iter < parameters->endIndex; iter++) {
+        float normalX = parameters->normalPointer[3 * iter + 0];
+        float normalY = parameters->normalPointer[3 * iter + 1];
+        float normalZ = parameters->normalPointer[3 * iter + 2];
+
+        for (unsigned int sample = 0; sample < sampleCount; sample++) {
+            float value = normalX * x[sample] + normalY * y[sample] + normalZ * z[sample];
+            visibility[sample] = (value > 0.f) ? value : 0.f;
+        }
+
+        for (int basis = 0; basis < BASIS_FUNCTION_COUNT; basis++) {
+            const float* values = &basisValues[basis * sampleCount];
+            float integral = 0.f;
+
+            for (unsigned int sample = 0; sample < sampleCount; sample++) integral += visibility[sample] * values[sample];
+
+            integral *= average;
+            integral *= domain;
+            parameters->coefficientPointer[BASIS_FUNCTION_COUNT * iter + basis] = integral;
+        }
+    }
+
+    return NULL;
+}
+
+void calculateVisibilityCoefficients(const float* normalPointer, unsigned int normalCount,
+    float* coefficientPointer, unsigned int thetaResolution, unsigned int phiResolution, int threadCount)
+{
+    std::vector<pthread_t> threadArray(threadCount);
+    std::vector<CalculateVisibilityCoefficientsParameters> inputArray(threadCount);
+
+    for (int threadIndex = 0; threadIndex < threadCount; threadIndex++) {
+        pthread_t* thread = &threadArray[threadIndex];
+        CalculateVisibilityCoefficientsParameters* input = &inputArray[threadIndex];
+
+        input->normalPointer = normalPointer;
+        input->coefficientPointer = coefficientPointer;
+        input->thetaResolution = thetaResolution;
+        input->phiResolution = phiResolution;
+
+        int totalIterations = normalCount;
+        input->startIndex = (threadIndex + 0) * totalIterations / threadCount;
+        input->endIndex = (threadIndex + 1) * totalIterations / threadCount;
+
+        pthread_create(thread, NULL, calculateVisibilityCoefficientsThreaded, (void*)input);
+    }
+
+    for (int threadIndex = 0; threadIndex < threadCount; threadIndex++) {
+        pthread_join(threadArray[threadIndex], NULL);
+    }
+}
+
+// normals are compared by exact value, so only bit-identical normals are merged
+
+struct NormalKey {
+    float x, y, z;
+
+    bool operator<(const NormalKey& other) const {
+        if (x != other.x) return x < other.x;
+        if (y != other.y) return y < other.y;
+        return z < other.z;
+    }
+};
+
+void calculateVisibilityCoefficientsDeduplicated(const float* normalPointer, unsigned int normalCount,
+    float* coefficientPointer, unsigned int thetaResolution, unsigned int phiResolution, int threadCount)
+{
+    std::map<NormalKey, unsigned int> uniqueIndices;
+    std::vector<unsigned int> remap(normalCount);
+    std::vector<float> uniqueNormals;
+
+    for (unsigned int iter = 0; iter < normalCount; iter++) {
+        NormalKey key;
+        key.x = normalPointer[3 * iter + 0];
+        key.y = normalPointer[3 * iter + 1];
+        key.z = normalPointer[3 * iter + 2];
+
+        std::map<NormalKey, unsigned int>::iterator found = uniqueIndices.find(key);
+        if (found == uniqueIndices.end()) {
+            unsigned int uniqueIndex = uniqueNormals.size() / 3;
+            uniqueIndices[key] = uniqueIndex;
+            uniqueNormals.push_back(key.x);
+            uniqueNormals.push_back(key.y);
+            uniqueNormals.push_back(key.z);
+            remap[iter] = uniqueIndex;
+        }
+        else {
+            remap[iter] = found->second;
+        }
+    }
+
+    unsigned int uniqueCount = uniqueNormals.size() / 3;
+    if (uniqueCount == 0) return;
+
+    std::vector<float> uniqueCoefficients(BASIS_FUNCTION_COUNT * uniqueCount);
+    calculateVisibilityCoefficients(&uniqueNormals[0], uniqueCount, &uniqueCoefficients[0],
+        thetaResolution, phiResolution, threadCount);
+
+    for (unsigned int iter = 0; iter < normalCount; iter++) {
+        for (int basis = 0; basis < BASIS_FUNCTION_COUNT; basis++) {
+            coefficientPointer[BASIS_FUNCTION_COUNT * iter + basis] =
+                uniqueCoefficients[BASIS_FUNCTION_COUNT * remap[iter] + basis];
+        }
+    }
+}
@@ -0,0 +1,50 @@
+#ifndef _VISIBILITYTRANSFER_H_
+#define _VISIBILITYTRANSFER_H_
+
+#include "SphericalFunction.h"
+
+#include <SFML/System/Vector3.hpp>
+
+// additional Vector3f functions
+
+inline float dotProduct(const sf::Vector3f& vectorA, const sf::Vector3f& vectorB) {
+    return (vectorA.x * vectorB.x + vectorA.y * vectorB.y + vectorA.z * vectorB.z);
+}
+
+// implementation of SphericalFunction which uses clamped dot product of a normal vector
+class SphericalFunctionNormalVisibility : public SphericalFunction<float> {
+    const sf::Vector3f& normal;
+public:
+    SphericalFunctionNormalVisibility(const sf::Vector3f& normal) :
+        normal(normal)
+    {
+    }
+    float getValue(const sf::Vector3f& v) {
+        float visibility = dotProduct(normal, v);
+        if (visibility < 0.f) visibility = 0.f;
+        return visibility;
+    }
+};
+
+// convenience structure to hold the parameters for the threaded function call
+struct CalculateVisibilityCoefficientsParameters {
+    const float* normalPointer;
+    float* coefficientPointer;
+    int startIndex;
+    int endIndex;
+    unsigned int thetaResolution;
+    unsigned int phiResolution;
+};
+
+// function to calculate a segment of the visibility coefficients
+void* calculateVisibilityCoefficientsThreaded(void* input);
+
+// divides the normals evenly between threads, BASIS_FUNCTION_COUNT coefficients per normal
+void calculateVisibilityCoefficients(const float* normalPointer, unsigned int normalCount,
+    float* coefficientPointer, unsigned int thetaResolution, unsigned int phiResolution, int threadCount);
+
+// same as above, but integrates each distinct normal only once and copies the result to duplicates
+void calculateVisibilityCoefficientsDeduplicated(const float* normalPointer, unsigned int normalCount,
+    float* coefficientPointer, unsigned int thetaResolution, unsigned int phiResolution, int threadCount);
+
+#endif
@@ -1,10 +1,25 @@
 #include "Model.h"
+#include "ColorExport.h"
 #include "Cubemap.h"
+#include "CompressedTransfer.h"
+#include "CubemapProjection.h"
+#include "EnvironmentSequence.h"
+#include "GlossyTransfer.h"
+#include "IrradianceCubemap.h"
+#include "LightProbeGrid.h"
+#include "Panorama.h"
+#include "ProxyTransfer.h"
+#include "ShadingCache.h"
+#include "ShadingPipeline.h"
+#include "Shading.h"
+#include "TransferTable.h"
+#include "VisibilityTransfer.h"
 #include "SphericalFunction.h"
 #include "SphericalHarmonics.h"
 
 #include <iostream>
 #include <string>
+#include <cstdlib>
 #include <vector>
 
 #include <SFML/Graphics.hpp>
@@ -16,8 +31,6 @@
 
   /*
      Proposed improvements:
-      -the SoftwareTextureSFML class can have textures that activate after the OpenGL window is made
-        this would allow preprocessing to occur without an unresponsive window (for cubemap calculations)
       -a progress bar could display the progress of preprocessing calculations
         the user would know what's going on
       -possible streaming of results by having additional thread for just drawing
@@ -25,45 +38,11 @@
         need a way to determine whether cached results are valid or not
   */
 
-// additional Vector3f functions
-
-float dotProduct(const sf::Vector3f& vectorA, const sf::Vector3f& vectorB) {
-    return (vectorA.x * vectorB.x + vectorA.y * vectorB.y + vectorA.z * vectorB.z);
-}
-
 std::ostream& operator<<(std::ostream& out, const sf::Vector3f& vector) {
     out << "<" << vector.x << "," << vector.y << "," << vector.z << ">";
     return out;
 }
 
-// implementation of SphericalFunction which uses cubemap texture look-up
-class SphericalFunctionCubemap : public SphericalFunction<sf::Vector3f> {
-    Cubemap& cubemap;
-public:
-    SphericalFunctionCubemap(Cubemap& cubemap) :
-        cubemap(cubemap)
-    {
-    }
-    sf::Vector3f getValue(const sf::Vector3f& v) {
-        return cubemap.getColorFromTexCoords(v);
-    }
-};
-
-// implementation of SphericalFunction which uses clamped dot product of a normal vector
-class SphericalFunctionNormalVisibility : public SphericalFunction<float> {
-    const sf::Vector3f& normal;
-public:
-    SphericalFunctionNormalVisibility(const sf::Vector3f& normal) :
-        normal(normal)
-    {
-    }
-    float getValue(const sf::Vector3f& v) {
-        float visibility = dotProduct(normal, v);
-        if (visibility < 0.f) visibility = 0.f;
-        return visibility;
-    }
-};
-
 void setup() {
     glClearColor(0.f, 0.f, 0.5f, 1.f);
 
@@ -78,10 +57,7 @@ void setup() {
     glMatrixMode(GL_MODELVIEW);
 }
 
-// global variable to hold vertex colors of model
-float* modelColors;
-
-void drawModel(const Model& model) {
+void drawModel(const Model& model, const float* modelColors) {
     glEnableClientState(GL_VERTEX_ARRAY);
     glVertexPointer(3, GL_FLOAT, 0, model.getVertexPointer());
 
@@ -132,95 +108,69 @@ void drawCubemap(const Cubemap& cubemap) {
 
 float angle = 0.f;
 
-/*
-   current function for getting per-vertex colors based on spherical harmonics lighting
-   takes normal coefficients and cubemap coefficients and performs dot product
-   which happens after appropriate cubemap coefficient rotation operations
-*/
-void calculateModelColors(unsigned int vertexCount, float* modelColors,
-    const float* normalSHCoeff, const sf::Vector3f* cubemapSHCoeff)
-{
-    for (int iter = 0; iter < vertexCount; iter++) {
-        sf::Vector3f vertexColor(0.f, 0.f, 0.f);
-
-        sf::Vector3f rotatedCubemapSHCoeff[BASIS_FUNCTION_COUNT];
-
-      // needed because cos/sin evaluate to double and fail Vector3 template matching
-      // but also creates slight gain in efficiency, so that's cool!
-        float cosAngle = cos(angle);
-        float sinAngle = sin(angle);
-        float cosAngle2 = cos(2.f * angle);
-        float sinAngle2 = sin(2.f * angle);
-
-      /*
-         rotation currently assumes there are exactly 9 basis functions (most likely true)
-         also, it only allows rotation around Z axis right now
-         will need the +/-90 degree rotations about X axis for ZYZ rotations (Z,X-90,Z,X+90,Z)
-         also, will want better organization to perform rotations easier
-      */
-        rotatedCubemapSHCoeff[0] = cubemapSHCoeff[0];
-
-        rotatedCubemapSHCoeff[1] = cosAngle * cubemapSHCoeff[1] + sinAngle * cubemapSHCoeff[3];
-        rotatedCubemapSHCoeff[2] = cubemapSHCoeff[2];
-        rotatedCubemapSHCoeff[3] = -sinAngle * cubemapSHCoeff[1] + cosAngle * cubemapSHCoeff[3];
-
-        rotatedCubemapSHCoeff[4] = cosAngle2 * cubemapSHCoeff[4] + sinAngle2 * cubemapSHCoeff[8];
-        rotatedCubemapSHCoeff[5] = cosAngle * cubemapSHCoeff[5] + sinAngle * cubemapSHCoeff[7];
-        rotatedCubemapSHCoeff[6] = cubemapSHCoeff[6];
-        rotatedCubemapSHCoeff[7] = -sinAngle * cubemapSHCoeff[5] + cosAngle * cubemapSHCoeff[7];
-        rotatedCubemapSHCoeff[8] = -sinAngle2 * cubemapSHCoeff[4] + cosAngle2 * cubemapSHCoeff[8];
-
-      // the per-color-channel dot product of cubemap coefficients and visibility coefficients
-        for (int basis = 0; basis < BASIS_FUNCTION_COUNT; basis++) {
-            vertexColor += rotatedCubemapSHCoeff[basis] *
-                normalSHCoeff[BASIS_FUNCTION_COUNT * iter + basis];
-        }
-  /*
-     dot product of coefficients is approximation of dot product times cubemap functions
-     to get average color for vertex, divide by domain of integral (2pi x pi)
-     however, average of dot product times cubemap will be too dark (most samples are zero)
-     integral of dot product times sine is pi, so multiplying by 2pi fixes this
-     since integral will be "brought up" to 2pi x pi and average "brought up" to 1 (at max)
-  */
+// everything needed to shade the model for a given rotation of the cubemap
+struct ModelShadingState {
+    unsigned int vertexCount;
+    const float* vertexPointer;
+    const float* normalPointer;
+    const float* normalSHCoeff;
+    const CompressedTransfer* compressedTransfer;
+    IrradianceCubemap* irradianceCubemap;
+    LightProbeGrid* probeGrid;
+    const GlossyTransfer* glossyTransfer;
+    sf::Vector3f eyePosition;
+    const sf::Vector3f* cubemapSHCoeff;
+
+  // optional, reuses colors shaded at cacheSteps quantised angles
+    ShadingCache* shadingCache;
+    unsigned int cacheSteps;
+};
 
-        vertexColor /= (float)(4.f * M_PI);
-        vertexColor *= 4.f; // correction for dot product
+void shadeModel(const ModelShadingState& state, float angle, float* modelColors) {
+    sf::Vector3f shadingSHCoeff[BASIS_FUNCTION_COUNT];
+    prepareShadingCoefficients(angle, state.cubemapSHCoeff, shadingSHCoeff);
 
-        modelColors[3 * iter + 0] = vertexColor.x;
-        modelColors[3 * iter + 1] = vertexColor.y;
-        modelColors[3 * iter + 2] = vertexColor.z;
+    if (state.probeGrid != NULL) {
+        state.probeGrid->prepare(angle);
+        state.probeGrid->calculateModelColors(state.vertexCount, state.vertexPointer, state.normalSHCoeff, modelColors);
+    }
+    else if (state.glossyTransfer != NULL) {
+        state.glossyTransfer->shade(shadingSHCoeff, state.vertexPointer, state.normalPointer, state.eyePosition,
+            modelColors);
+    }
+    else if (state.irradianceCubemap != NULL) {
+      // baked for the unrotated lighting, and only touched again when the coefficients change (e.g. -sequence),
+      // the normals are turned instead
+        sf::Vector3f unrotatedSHCoeff[BASIS_FUNCTION_COUNT];
+        prepareShadingCoefficients(0.f, state.cubemapSHCoeff, unrotatedSHCoeff);
+
+        state.irradianceCubemap->refresh(unrotatedSHCoeff);
+        state.irradianceCubemap->calculateModelColors(state.vertexCount, state.normalPointer, modelColors, angle);
     }
+    else if (state.compressedTransfer != NULL)
+        state.compressedTransfer->shade(shadingSHCoeff, modelColors);
+    else
+        calculateModelColors(state.vertexCount, modelColors, state.normalSHCoeff, shadingSHCoeff);
 }
 
-// convenience structure to hold the parameters for the threaded function call
-struct CalculateVisibilityCoefficientsParameters {
-    const float* normalPointer;
-    float* coefficientPointer;
-    int startIndex;
-    int endIndex;
-};
-
-// function to calculate a segment of the visibility coefficients
-void* calculateVisibilityCoefficientsThreaded(void* input) {
-    CalculateVisibilityCoefficientsParameters* parameters =
-        (CalculateVisibilityCoefficientsParameters*)input;
-
-    for (int iter = parameters->startIndex; iter < parameters->endIndex; iter++) {
-        sf::Vector3f normal;
-        normal.x = parameters->normalPointer[3 * iter + 0];
-        normal.y = parameters->normalPointer[3 * iter + 1];
-        normal.z = parameters->normalPointer[3 * iter + 2];
+// colors for one frame, with the cache they come from the two nearest quantised angles, shading each one only once
+void shadeFrame(void* context, float angle, float* modelColors) {
+    const ModelShadingState& state = *(const ModelShadingState*)context;
 
-        SphericalFunctionNormalVisibility visibleFunction(normal);
+    if (state.shadingCache != NULL) {
+        unsigned long keyA, keyB;
+        float weightB;
+        ShadingCache::getRotationKeys(angle, state.cacheSteps, keyA, keyB, weightB);
 
-        unsigned int thetaResolution = 16, phiResolution = 32;
-        for (int basis = 0; basis < BASIS_FUNCTION_COUNT; basis++) {
-            SphericalFunctionProduct<float,float,float> product(visibleFunction,
-                SphericalHarmonics[basis]);
+        if (state.shadingCache->find(keyA) == NULL)
+            shadeModel(state, ShadingCache::getRotationAngle(keyA, state.cacheSteps), state.shadingCache->insert(keyA));
+        if (state.shadingCache->find(keyB) == NULL)
+            shadeModel(state, ShadingCache::getRotationAngle(keyB, state.cacheSteps), state.shadingCache->insert(keyB));
 
-            parameters->coefficientPointer[BASIS_FUNCTION_COUNT * iter + basis] =
-                product.integrate(thetaResolution, phiResolution);
-        }
+        state.shadingCache->blend(keyA, keyB, weightB, modelColors);
+    }
+    else {
+        shadeModel(state, angle, modelColors);
     }
 }
 
@@ -231,60 +181,291 @@ int main(int argc, char** argv) {
     std::string cubemapDir = "gradientCube";
     if (argc > 2) cubemapDir = argv[2];
 
-    Model testModel(modelPath);
+  // optional arguments come in pairs after the model path and cubemap directory
+  // -transfer float|half|byte|cpca selects how the normal coefficients are stored
+  // -bake exact|dedup|table|proxy selects how the normal coefficients are calculated
+  // -proxyResolution <cells> sets the clustering grid of -bake proxy along the longest side (default 32)
+  // -tolerance <error> integrates the cubemap adaptively instead of on a fixed grid
+  // -panorama <file> lights the model from an equirectangular .hdr or .pfm instead of the cubemap
+  // -cache <megabytes> reuses colors shaded at -cacheSteps quantised angles per turn (default 256)
+  // -irradiance <resolution> shades by looking normals up in a baked irradiance cubemap
+  // -probes <file> lights each vertex from a grid of cubemaps described in the file (see LightProbeGrid.h)
+  // -glossy <shininess> shades a view-dependent Phong lobe through per-vertex transfer matrices
+  // -pipeline on shades the next frame on a worker thread while the current one is drawn
+  // -sequence <pattern> lights the model from numbered cubemap directories, e.g. capture/frame%04d, played back
+  //   at -sequenceRate frames per second (default 30), -sequenceFrames <count> of them (default 1),
+  //   with their coefficients written to -sequenceOutput <file> if given
+  // -export <name> publishes every frame's colors in a POSIX shared memory ring (see ColorExport.h)
+    std::string transferFormat = "float";
+    unsigned int clusterCount = 32;
+    std::string bakeMode = "exact";
+    unsigned int tableResolution = 32;
+    unsigned int proxyResolution = 32;
+    float cubemapTolerance = 0.f;
+    std::string panoramaPath;
+    unsigned int cacheMegabytes = 0;
+    unsigned int cacheSteps = 256;
+    unsigned int irradianceResolution = 0;
+    std::string probeGridPath;
+    bool pipelined = false;
+    float glossyShininess = 0.f;
+    std::string exportName;
+    std::string sequencePattern;
+    unsigned int sequenceFrameCount = 1;
+    float sequenceRate = 30.f;
+    std::string sequenceOutputPath;
+
+    for (int argIter = 3; argIter + 1 < argc; argIter += 2) {
+        std::string option = argv[argIter];
+        std::string value = argv[argIter + 1];
+
+        if (option == "-transfer") {
+            if (value == "float" || value == "half" || value == "byte" || value == "cpca") transferFormat = value;
+            else std::cout << "unknown transfer format " << value << std::endl;
+        }
+        else if (option == "-clusters") clusterCount = atoi(value.c_str());
+        else if (option == "-bake") bakeMode = value;
+        else if (option == "-tableResolution") tableResolution = atoi(value.c_str());
+        else if (option == "-proxyResolution") proxyResolution = atoi(value.c_str());
+        else if (option == "-tolerance") cubemapTolerance = atof(value.c_str());
+        else if (option == "-panorama") panoramaPath = value;
+        else if (option == "-cache") cacheMegabytes = atoi(value.c_str());
+        else if (option == "-cacheSteps") cacheSteps = atoi(value.c_str());
+        else if (option == "-irradiance") irradianceResolution = atoi(value.c_str());
+        else if (option == "-probes") probeGridPath = value;
+        else if (option == "-pipeline") pipelined = (value == "on");
+        else if (option == "-glossy") glossyShininess = atof(value.c_str());
+        else if (option == "-export") exportName = value;
+        else if (option == "-sequence") sequencePattern = value;
+        else if (option == "-sequenceFrames") sequenceFrameCount = atoi(value.c_str());
+        else if (option == "-sequenceRate") sequenceRate = atof(value.c_str());
+        else if (option == "-sequenceOutput") sequenceOutputPath = value;
+        else std::cout << "unknown option " << option << std::endl;
+    }
 
-    modelColors = new float[3 * testModel.getVertexCount()];
-    float* normalSHCoeff = new float[BASIS_FUNCTION_COUNT * testModel.getVertexCount()];
+  // the irradiance cubemap replaces the normal coefficients, so these would be silently ignored
+    if (irradianceResolution > 0 && (transferFormat != "float" || !probeGridPath.empty())) {
+        std::cout << "-irradiance cannot be combined with -transfer or -probes" << std::endl;
+        return 1;
+    }
 
-  // calculate integrals of dot product function multiplied by basis functions
-    std::cout << "calculating SH coefficients of normals..." << std::endl;
+  // positions, normals, normal coefficients and colors all live in the model's vertex stream
+  // irradiance shading only looks normals up, so it leaves out the coefficients
+    Model testModel;
+    if (!testModel.loadFromFile(modelPath, (irradianceResolution > 0) ? 0 : BASIS_FUNCTION_COUNT)) {
+        std::cout << "could not read model " << modelPath << std::endl;
+        return 1;
+    }
+
+    VertexStream& vertexStream = testModel.getVertexStream();
+    float* normalSHCoeff = (irradianceResolution > 0) ? NULL : vertexStream.getTransferPointer();
+    float* modelColors = vertexStream.getColorPointer();
 
   // divide work into threads
     const int threadCount = 4;
-    pthread_t threadArray[threadCount];
-    CalculateVisibilityCoefficientsParameters inputArray[threadCount];
+    unsigned int thetaResolution = 16, phiResolution = 32;
 
-    for (int threadIndex = 0; threadIndex < threadCount; threadIndex++) {
-        pthread_t* thread = &threadArray[threadIndex];
-        CalculateVisibilityCoefficientsParameters* input = &inputArray[threadIndex];
+  // calculate integrals of dot product function multiplied by basis functions
+    if (irradianceResolution == 0) std::cout << "calculating SH coefficients of normals..." << std::endl;
 
-        input->normalPointer = testModel.getNormalPointer();
-        input->coefficientPointer = normalSHCoeff;
+    if (irradianceResolution > 0) {
+      // nothing to bake, the irradiance cubemap is baked from the lighting below
+    }
+    else if (bakeMode == "table") {
+        TransferTable transferTable;
+        transferTable.build(tableResolution, thetaResolution, phiResolution, threadCount);
+        transferTable.calculateCoefficients(testModel.getNormalPointer(), testModel.getVertexCount(), normalSHCoeff);
+    }
+    else if (bakeMode == "proxy") {
+        ProxyTransferReport report;
+        calculateVisibilityCoefficientsProxy(testModel.getVertexPointer(), testModel.getNormalPointer(),
+            testModel.getVertexCount(), testModel.getIndexPointer(), testModel.getTriangleCount(), normalSHCoeff,
+            proxyResolution, thetaResolution, phiResolution, threadCount, 512, report);
+
+        std::cout << "proxy mesh: " << report.proxyVertexCount << " vertices, " << report.proxyTriangleCount <<
+            " triangles" << std::endl;
+        std::cout << "proxy coefficient error over " << report.sampleCount << " vertices: max " <<
+            report.maximumError << ", rms " << report.rmsError << " (bounds color error per unit of lighting)" << std::endl;
+    }
+    else if (bakeMode == "dedup") {
+        calculateVisibilityCoefficientsDeduplicated(testModel.getNormalPointer(), testModel.getVertexCount(),
+            normalSHCoeff, thetaResolution, phiResolution, threadCount);
+    }
+    else {
+        calculateVisibilityCoefficients(testModel.getNormalPointer(), testModel.getVertexCount(),
+            normalSHCoeff, thetaResolution, phiResolution, threadCount);
+    }
 
-        int totalIterations = testModel.getVertexCount();
-        input->startIndex = (threadIndex + 0) * totalIterations / threadCount;
-        input->endIndex = (threadIndex + 1) * totalIterations / threadCount;
+  // glossy transfer matrices are baked next to the diffuse coefficients, at the same resolution
+    GlossyTransfer* glossyTransfer = NULL;
 
-        pthread_create(thread, NULL, calculateVisibilityCoefficientsThreaded, (void*)input);
-    }
+    if (glossyShininess > 0.f) {
+      // glossy shading replaces the diffuse transfer, so these would be silently ignored
+        if (transferFormat != "float" || irradianceResolution > 0 || !probeGridPath.empty()) {
+            std::cout << "-glossy needs -transfer float and cannot be combined with -irradiance or -probes" << std::endl;
+            return 1;
+        }
+
+        std::cout << "calculating SH transfer matrices of normals..." << std::endl;
 
-    for (int threadIndex = 0; threadIndex < threadCount; threadIndex++) {
-        pthread_join(threadArray[threadIndex], NULL);
+        glossyTransfer = new GlossyTransfer(glossyShininess);
+        glossyTransfer->bake(testModel.getNormalPointer(), testModel.getVertexCount(),
+            thetaResolution, phiResolution, threadCount);
     }
 
-    sf::RenderWindow window(sf::VideoMode(800, 600), "Spherical Harmonics Test");
-    window.setFramerateLimit(60);
+  // optionally replace the float coefficients with a compressed copy to save memory and bandwidth
+    CompressedTransfer compressedTransfer;
+    bool useCompressedTransfer = (transferFormat != "float");
 
-  // provide a directory containing images named negativeX.png, positiveY.png, etc.
-    Cubemap testCubemap(cubemapDir);
+    if (useCompressedTransfer) {
+        CompressedTransfer::Format format = CompressedTransfer::FORMAT_HALF;
+        if (transferFormat == "byte") format = CompressedTransfer::FORMAT_BYTE;
+        else if (transferFormat == "cpca") format = CompressedTransfer::FORMAT_CLUSTERED_PCA;
 
-    SphericalFunctionCubemap sphericalCubemap(testCubemap);
+        compressedTransfer.compress(normalSHCoeff, testModel.getVertexCount(), format, clusterCount);
+
+        CompressedTransferError error = compressedTransfer.calculateError(normalSHCoeff);
+        std::cout << "compressed transfer: " << error.byteCount << " bytes (from " <<
+            error.uncompressedByteCount << "), maximum error " << error.maximumError <<
+            ", rms error " << error.rmsError << std::endl;
+
+      // dropping the float coefficients moves the other planes, so refresh their pointers
+        vertexStream.setTransferStride(0);
+        normalSHCoeff = NULL;
+        modelColors = vertexStream.getColorPointer();
+    }
 
     sf::Vector3f cubemapSHCoeff[BASIS_FUNCTION_COUNT];
 
-  // calculate integrals of cubemap "function" multiplied by basis functions
-    std::cout << "calculating SH coefficients of cubemap..." << std::endl;
+  // the cubemap is only loaded (and drawn) when the lighting does not come from a panorama
+    Cubemap* testCubemap = NULL;
+    EnvironmentSequence* environmentSequence = NULL;
 
-    unsigned int thetaResolution = 256, phiResolution = 512;
-    for (int basis = 0; basis < BASIS_FUNCTION_COUNT; basis++) {
-        SphericalFunctionProduct<sf::Vector3f, float, sf::Vector3f> product(sphericalCubemap,
-            SphericalHarmonics[basis]);
+    if (!panoramaPath.empty()) {
+        std::cout << "calculating SH coefficients of panorama..." << std::endl;
 
-        cubemapSHCoeff[basis] = product.integrate(thetaResolution, phiResolution);
+        if (!calculatePanoramaCoefficients(panoramaPath, cubemapSHCoeff)) {
+            std::cout << "could not read panorama " << panoramaPath << std::endl;
+            return 1;
+        }
     }
+    else if (!sequencePattern.empty()) {
+      // cached and pipelined colors are only valid for one environment
+        if (cacheMegabytes > 0 || pipelined) {
+            std::cout << "-sequence cannot be combined with -cache or -pipeline" << std::endl;
+            return 1;
+        }
+
+        std::cout << "projecting environment sequence..." << std::endl;
+
+        environmentSequence = new EnvironmentSequence(sequencePattern, sequenceFrameCount, 256, 512, 2, threadCount);
+        if (!environmentSequence->start(sequenceOutputPath)) {
+            std::cout << "could not start environment sequence " << sequencePattern << std::endl;
+            return 1;
+        }
+
+      // the first frame is waited for, later ones are picked up by the render loop when they are due
+        EnvironmentFrame frame;
+        if (!environmentSequence->next(frame, true) || !frame.loaded) {
+            std::cout << "could not read the first frame of " << sequencePattern << std::endl;
+            return 1;
+        }
+
+        for (int basis = 0; basis < BASIS_FUNCTION_COUNT; basis++) cubemapSHCoeff[basis] = frame.coefficients[basis];
+    }
+    else {
+      // provide a directory containing images named negativeX.png, positiveY.png, etc.
+        testCubemap = new Cubemap();
+        if (!testCubemap->loadFromDirectory(cubemapDir)) {
+            std::cout << "could not read cubemap " << cubemapDir << std::endl;
+            delete testCubemap;
+            return 1;
+        }
+
+      // calculate integrals of cubemap "function" multiplied by basis functions
+        std::cout << "calculating SH coefficients of cubemap..." << std::endl;
+
+        if (cubemapTolerance > 0.f) {
+            float errorEstimate = calculateCubemapCoefficientsAdaptive(*testCubemap, cubemapTolerance, cubemapSHCoeff);
+            std::cout << "cubemap error estimate: " << errorEstimate << std::endl;
+        }
+        else {
+            thetaResolution = 256;
+            phiResolution = 512;
+            calculateCubemapCoefficients(*testCubemap, thetaResolution, phiResolution, cubemapSHCoeff, threadCount);
+        }
+    }
+
+    IrradianceCubemap* irradianceCubemap = NULL;
+    if (irradianceResolution > 0) irradianceCubemap = new IrradianceCubemap(irradianceResolution, threadCount);
+
+  // probes are blended with the float normal coefficients, so they cannot be combined with compression
+    LightProbeGrid* probeGrid = NULL;
+
+    if (!probeGridPath.empty()) {
+        if (useCompressedTransfer) {
+            std::cout << "-probes needs -transfer float" << std::endl;
+            return 1;
+        }
+
+        std::cout << "calculating SH coefficients of light probes..." << std::endl;
+
+        probeGrid = new LightProbeGrid();
+        if (!probeGrid->loadFromFile(probeGridPath, 64, 128, threadCount)) {
+            std::cout << "could not read light probe grid " << probeGridPath << std::endl;
+            return 1;
+        }
+    }
+
+    ModelShadingState shadingState;
+    shadingState.vertexCount = testModel.getVertexCount();
+    shadingState.vertexPointer = testModel.getVertexPointer();
+    shadingState.normalPointer = testModel.getNormalPointer();
+    shadingState.normalSHCoeff = normalSHCoeff;
+    shadingState.compressedTransfer = useCompressedTransfer ? &compressedTransfer : NULL;
+    shadingState.irradianceCubemap = irradianceCubemap;
+    shadingState.probeGrid = probeGrid;
+    shadingState.glossyTransfer = glossyTransfer;
+
+  // the eye in model space, undoing the translation and scale applied before drawModel
+    shadingState.eyePosition = sf::Vector3f(0.f, 0.f, 200.f);
+    shadingState.cubemapSHCoeff = cubemapSHCoeff;
+
+    ShadingCache* shadingCache = NULL;
+    if (cacheMegabytes > 0 && cacheSteps > 0)
+        shadingCache = new ShadingCache(3 * testModel.getVertexCount(), (size_t)cacheMegabytes << 20);
+
+    shadingState.shadingCache = shadingCache;
+    shadingState.cacheSteps = cacheSteps;
+
+  // once started, the shading state belongs to the worker thread
+    ShadingPipeline* shadingPipeline = NULL;
+    if (pipelined) {
+        shadingPipeline = new ShadingPipeline(3 * testModel.getVertexCount(), shadeFrame, (void*)&shadingState);
+        shadingPipeline->start(angle);
+    }
+
+  // a few slots, so readers a frame or two behind still find their frame intact
+    ColorExport colorExport;
+    if (!exportName.empty() && !colorExport.open(exportName, 3 * testModel.getVertexCount(), 4)) {
+        std::cout << "could not create shared memory " << exportName << std::endl;
+        return 1;
+    }
+
+  // preprocessing is done before the window opens, so it never sits unresponsive
+  // cubemap textures can only be created once its OpenGL context exists
+    sf::RenderWindow window(sf::VideoMode(800, 600), "Spherical Harmonics Test");
+    window.setFramerateLimit(60);
+
+    if (testCubemap != NULL) testCubemap->uploadTextures();
 
     setup();
 
+  // sequence frames are due at sequenceRate from here on, a frame not yet projected when due counts as late
+    sf::Clock sequenceClock;
+    unsigned int sequenceFramesShown = 1, sequenceFramesLate = 0;
+    bool sequenceBehind = false;
+
     while (window.isOpen()) {
         sf::Event event;
 
@@ -292,9 +473,46 @@ int main(int argc, char** argv) {
             if (event.type == sf::Event::Closed) window.close();
         }
 
-        calculateModelColors(testModel.getVertexCount(), modelColors, normalSHCoeff, cubemapSHCoeff);
+      // pipelined colors lag behind by however long shading takes, drawing never waits for them
+        if (environmentSequence != NULL && sequenceFramesShown < sequenceFrameCount &&
+            sequenceClock.getElapsedTime().asSeconds() * sequenceRate >= sequenceFramesShown) {
+            EnvironmentFrame frame;
+
+            if (environmentSequence->next(frame, false)) {
+                if (frame.loaded) {
+                    for (int basis = 0; basis < BASIS_FUNCTION_COUNT; basis++)
+                        cubemapSHCoeff[basis] = frame.coefficients[basis];
+                }
+                else {
+                    std::cout << "could not read frame " << frame.index << " of " << sequencePattern << std::endl;
+                }
+
+                sequenceFramesShown++;
+                sequenceBehind = false;
+
+                if (sequenceFramesShown == sequenceFrameCount) {
+                    std::cout << "environment sequence done: " << sequenceFramesShown << " frames in " <<
+                        sequenceClock.getElapsedTime().asSeconds() << " s, " << sequenceFramesLate << " late" << std::endl;
+                }
+            }
+            else if (!sequenceBehind) {
+                sequenceFramesLate++;
+                sequenceBehind = true;
+            }
+        }
+
+        const float* frameColors = modelColors;
+        if (shadingPipeline != NULL) {
+            shadingPipeline->request(angle);
+            frameColors = shadingPipeline->acquire();
+        }
+        else {
+            shadeFrame((void*)&shadingState, angle, modelColors);
+        }
         angle += 0.01f;
 
+        if (colorExport.isOpen()) colorExport.publish(frameColors);
+
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
         glBindTexture(GL_TEXTURE_2D, 0);
@@ -305,7 +523,7 @@ int main(int argc, char** argv) {
         //glRotatef(angle, 0.f, 1.f, 0.f);
         glScalef(0.01f, 0.01f, 0.01f);
 
-        drawModel(testModel);
+        drawModel(testModel, frameColors);
 
   // cubemap is "infinitely far away", no translation in modelview matrix
   // also, its faces just looks weird at an angle
@@ -319,10 +537,18 @@ int main(int argc, char** argv) {
         glRotatef(angle * 180.f / M_PI, 0.f, 0.f, 1.f);
         glScalef(5.f, 5.f, 5.f);
 
-        drawCubemap(testCubemap);
+        if (testCubemap != NULL) drawCubemap(*testCubemap);
 
         window.display();
     }
 
+    delete shadingPipeline;
+    delete environmentSequence;
+    delete testCubemap;
+    delete shadingCache;
+    delete irradianceCubemap;
+    delete probeGrid;
+    delete glossyTransfer;
+
     return 0;
 }
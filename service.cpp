@@ -0,0 +1,24 @@
+#include "ProjectionService.h"
+
+#include <csignal>
+#include <cstdlib>
+#include <string>
+
+// resident projection service, see ProjectionService.h for the request format
+
+int main(int argc, char** argv) {
+    std::string socketPath = "/tmp/SphericalHarmonicsService.sock";
+    if (argc > 1) socketPath = argv[1];
+
+    int threadCount = 4;
+    if (argc > 2) threadCount = atoi(argv[2]);
+    if (threadCount < 1) threadCount = 1;
+
+  // a client that disconnects before reading its reply must not end the service
+    signal(SIGPIPE, SIG_IGN);
+
+    ProjectionService service(threadCount);
+    if (!service.run(socketPath)) return 1;
+
+    return 0;
+}